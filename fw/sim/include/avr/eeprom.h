@@ -0,0 +1,15 @@
+// -------------------------------------------------------------------------------------------------
+// Host build: EEMEM objects are placed in the sim_eeprom section, the simulated EEPROM (sim.c).
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// -------------------------------------------------------------------------------------------------
+
+#define EEMEM							__attribute__((section("sim_eeprom")))
+
+#define eeprom_read_block(dst, src, n)	memcpy(dst, src, n)
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,55 @@
+// -------------------------------------------------------------------------------------------------
+// Host build: ATmega328P I/O registers are plain memory (sim.c), at their data space addresses.
+
+#pragma once
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------------------------------------
+
+extern volatile uint8_t sim_reg[0x100];
+
+#define PINB		sim_reg[0x23]
+#define DDRB		sim_reg[0x24]
+#define PORTB		sim_reg[0x25]
+#define PINC		sim_reg[0x26]
+#define DDRC		sim_reg[0x27]
+#define PORTC		sim_reg[0x28]
+#define PIND		sim_reg[0x29]
+#define DDRD		sim_reg[0x2A]
+#define PORTD		sim_reg[0x2B]
+#define PCIFR		sim_reg[0x3B]
+#define GPIOR0		sim_reg[0x3E]
+#define EECR		sim_reg[0x3F]
+#define EEDR		sim_reg[0x40]
+#define GPIOR1		sim_reg[0x4A]
+#define GPIOR2		sim_reg[0x4B]
+#define PCICR		sim_reg[0x68]
+#define PCMSK0		sim_reg[0x6B]
+#define PCMSK2		sim_reg[0x6D]
+
+#define PB0			0
+#define PB1			1
+#define PB2			2
+#define PB3			3
+#define PB4			4
+#define PB5			5
+#define PD0			0
+#define PD1			1
+#define PD2			2
+#define PD3			3
+
+#define EERE		0
+#define EEPE		1
+#define EEMPE		2
+#define EERIE		3
+
+#define PCINT0		0
+#define PCINT1		1
+#define PCINT16		0
+#define PCIF0		0
+#define PCIF2		2
+#define PCIE0		0
+#define PCIE2		2
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,13 @@
+// -------------------------------------------------------------------------------------------------
+// Host build: program memory is data memory, reads keep the pointed type.
+
+#pragma once
+
+// -------------------------------------------------------------------------------------------------
+
+#define PROGMEM
+
+#define pgm_read_byte(p)		(*(p))
+#define pgm_read_word(p)		(*(p))
+
+// -------------------------------------------------------------------------------------------------
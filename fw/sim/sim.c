@@ -0,0 +1,546 @@
+// -------------------------------------------------------------------------------------------------
+// RO controller host simulation.
+// ro.c, the OS task and timer modules and the EEPROM modules are built from fw/src against
+// simulated ports, EEPROM and time (include/avr). Time is fast-forwarded from one event to the
+// next: timer deadline, RTC tick (2s), EEPROM write or script command.
+//
+// Usage: ro_sim [-v] [-d days] [-h holdup_ms] [-e eeprom.bin] script
+//   -v              prints the state changes
+//   -d days         number of days to run the script for, default 1
+//   -h holdup_ms    MCU supply hold-up after the power fail detection, default 116ms
+//   -e eeprom.bin   EEPROM image, loaded at start if present and saved at the end
+//
+// Script lines, repeated every day, in time order: hh:mm:ss command [arg]
+//   inlet 0|1       inlet water switch (DI A)
+//   refill 0|1      refill request switch (DI B)
+//   power on|off    VIN above or below the threshold (ro_enable, ro_disable)
+//   power cut       VIN lost: power off, then the MCU resets after holdup_ms. Queued EEPROM
+//                   writes not done by then are lost, EEPROM is loaded as after the reset and
+//                   the counters are checked against the power off values.
+//   flush           manual flush (menu)
+//   reset           alarm reset (menu)
+//   off 0|1         controller off setting (menu)
+//
+// Exit status is nonzero if a check failed: counters lost by a power cut, or the WORK output
+// on-time seen on the port differs from the total run time counter.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <avr/io.h>
+#include "lib/os/os.h"
+#include "lib/rtc.h"
+#include "lib/ee.h"
+#include "ro.h"
+#include "hwconf.h"
+
+// -------------------------------------------------------------------------------------------------
+// Firmware data kept by the modules not built for the host
+
+volatile uint8_t sim_reg[0x100];
+
+uint8_t os_que_st;				// os.c
+uint32_t t_rtc_sec;				// rtc_int.S
+
+// -------------------------------------------------------------------------------------------------
+// Simulation state
+
+#define SIM_TICK_FREQ		128			// Timer2 count, OS tick
+#define SIM_RTC_TICKS		256			// Timer2 overflow, RTC tick (2s)
+#define SIM_EE_WRITE_US		3400		// EEPROM byte write
+#define SIM_EE_SIZE			1024
+#define SIM_EV_MAX			256
+
+struct sim_ev {
+	uint32_t t;					// seconds of the day
+	char cmd[16];
+	char arg[16];
+};
+
+// Counters checked over a power cut
+struct sim_cnt {
+	uint32_t starts;
+	uint32_t flushes;
+	uint32_t filter_total;
+	uint32_t filter_work;
+	uint32_t on;
+	uint32_t run;
+};
+
+static struct {
+	uint64_t tick;				// ticks since start
+	uint16_t sec_prev;			// tick of the last second counter update
+	uint8_t pwr;
+	uint8_t state;
+	uint8_t verbose;
+	uint32_t holdup_us;
+	uint64_t work_ticks;		// WORK output on-time
+	uint32_t run_start;			// total run time counter at start
+	uint64_t task_runs;
+	uint32_t state_changes;
+	uint32_t beeps;
+	uint32_t cuts;
+	uint32_t errors;
+	uint32_t ee_us;				// EEPROM write time budget
+	uint32_t ee_writes;
+	uint32_t ee_wear[SIM_EE_SIZE];
+} sim;
+
+static struct sim_ev sim_ev[SIM_EV_MAX];
+static uint16_t sim_ev_n;
+
+// -------------------------------------------------------------------------------------------------
+// Modules not built for the host
+
+void beep(uint8_t dur)
+{
+	sim.beeps++;
+}
+
+void clk_fast_begin()
+{
+}
+
+void clk_fast_end()
+{
+}
+
+static void sim_nop(struct task_handle *task)
+{
+}
+
+struct task_handle adc_buf_done_task = TASK_HANDLE(sim_nop);
+struct task_handle btn_edge_task = TASK_HANDLE(sim_nop);
+struct task_handle ee_done_task = TASK_HANDLE(sim_nop);
+
+// -------------------------------------------------------------------------------------------------
+// OS tick and RTC tick tasks (os.c tick_upd, main.c rtc_tick)
+
+static void sim_tick_upd(struct task_handle *task)
+{
+	uint8_t qs = os_que_st;
+	t_tick = t_tick_src;
+	if(qs & OS_QUE_ST_TMR_ONS_TICK)
+		tmr_ons_sched(&tmr_ons_tick, t_tick, TASK_PRIORITY_NORMAL);
+	if(qs & OS_QUE_ST_TMR_INT_TICK)
+		tmr_int_sched(&tmr_int_tick, t_tick, TASK_PRIORITY_NORMAL);
+	if((uint16_t)(t_tick - sim.sec_prev) >= OS_TICK_SEC_DIV_INT) {
+		while((uint16_t)(t_tick - sim.sec_prev) >= OS_TICK_SEC_DIV_INT) {
+			t_sec++;
+			sim.sec_prev += OS_TICK_SEC_DIV_INT;
+		}
+		if(qs & OS_QUE_ST_TMR_ONS_SEC)
+			tmr_ons_sched(&tmr_ons_sec, t_sec, TASK_PRIORITY_LOW);
+		if(qs & OS_QUE_ST_TMR_INT_SEC)
+			tmr_int_sched(&tmr_int_sec, t_sec, TASK_PRIORITY_LOW);
+	}
+}
+
+static void sim_rtc_tick(struct task_handle *task)
+{
+	t_rtc_sec += 2;
+	tmr_rtc_sched();
+}
+
+struct task_handle tick_upd_task = TASK_HANDLE(sim_tick_upd);
+struct task_handle rtc_tick_task = TASK_HANDLE(sim_rtc_tick);
+
+// Returns the number of ticks until the next tick or second timer deadline, max n (os.c tick_idle).
+static uint16_t sim_tick_idle(uint16_t n)
+{
+	uint8_t qs = os_que_st;
+	uint16_t d;
+	if(qs & OS_QUE_ST_TMR_ONS_TICK) {
+		d = tmr_ons_next(&tmr_ons_tick, t_tick);
+		if(d < n) n = d;
+	}
+	if(qs & OS_QUE_ST_TMR_INT_TICK) {
+		d = tmr_int_next(&tmr_int_tick, t_tick);
+		if(d < n) n = d;
+	}
+	d = n / OS_TICK_SEC_DIV_INT + 1;
+	if(qs & OS_QUE_ST_TMR_ONS_SEC) {
+		uint16_t s = tmr_ons_next(&tmr_ons_sec, t_sec);
+		if(s < d) d = s;
+	}
+	if(qs & OS_QUE_ST_TMR_INT_SEC) {
+		uint16_t s = tmr_int_next(&tmr_int_sec, t_sec);
+		if(s < d) d = s;
+	}
+	d = (d != 0) ? (d * OS_TICK_SEC_DIV_INT - (uint16_t)(t_tick - sim.sec_prev)) : 0;
+	if(d < n) n = d;
+	return n;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Scheduler loop (os.c os_run), runs the tasks until the queues are empty.
+
+#if (OS_TASK_FLAG_COUNT > 16)
+#error "sim: OS_TASK_FLAG_COUNT > 16 not supported"
+#endif
+
+static uint8_t sim_flag_check()
+{
+	return OS_TASK_REG_0 | OS_TASK_REG_1;
+}
+
+static void sim_os_run()
+{
+	uint8_t f0, f1;
+	for(;;) {
+		if(sim_flag_check()) {
+			f0 = OS_TASK_REG_0;
+			f1 = OS_TASK_REG_1;
+			OS_TASK_REG_0 = 0;
+			OS_TASK_REG_1 = 0;
+			if(f0 != 0)
+				task_sched_flags(0, f0);
+			if(f1 != 0)
+				task_sched_flags(8, f1);
+		}
+		if(task_run_next())
+			sim.task_runs++;
+		else if(!sim_flag_check())
+			break;
+	}
+	if(ro_get_state() != sim.state) {
+		sim.state = ro_get_state();
+		sim.state_changes++;
+		if(sim.verbose) {
+			static const char *name[] = { "DISABLED", "OFF", "IDLE", "WORK", "FLUSH", "NOWATER", "TIMEOUT" };
+			uint32_t t = (uint32_t)(sim.tick / SIM_TICK_FREQ);
+			printf("%u %02u:%02u:%02u %s\n", t / 86400, t / 3600 % 24, t / 60 % 60, t % 60, name[sim.state]);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------------------------
+// EEPROM: EEMEM objects in the sim_eeprom section, written by the EE_READY interrupt model.
+
+extern uint8_t __start_sim_eeprom[];
+extern uint8_t __stop_sim_eeprom[];
+
+extern uint8_t ee_que_data[EE_QUE_LEN];
+extern volatile uint8_t ee_que_head;
+extern volatile uint8_t ee_que_tail;
+extern uint16_t ee_seg_addr[EE_SEG_LEN];
+extern uint8_t ee_seg_len[EE_SEG_LEN];
+extern volatile uint8_t ee_seg_head;
+extern volatile uint8_t ee_seg_tail;
+
+// EEPROM offset of the 16-bit queued address (low bits of the host pointer).
+static uint16_t sim_ee_ofs(uint16_t addr)
+{
+	uint16_t ofs = addr - (uint16_t)(uintptr_t)__start_sim_eeprom;
+	if(ofs >= __stop_sim_eeprom - __start_sim_eeprom) {
+		fprintf(stderr, "sim: EEPROM write out of range, offset %u\n", ofs);
+		exit(2);
+	}
+	return ofs;
+}
+
+// EEPROM ready interrupt (ee_int.S), writes the queued bytes for us microseconds.
+static void sim_ee_run(uint32_t us)
+{
+	uint8_t i, data;
+	uint16_t ofs;
+	if(!(EECR & (1<<EERIE)))
+		return;
+	sim.ee_us += us;
+	for(;;) {
+		if(ee_seg_head == ee_seg_tail) {
+			EECR &= ~(1<<EERIE);
+			TASK_FLAG_SET(EE_DONE_FLAG);
+			sim.ee_us = 0;
+			return;
+		}
+		i = ee_seg_head & (EE_SEG_LEN - 1);
+		ofs = sim_ee_ofs(ee_seg_addr[i]);
+		data = ee_que_data[ee_que_head & (EE_QUE_LEN - 1)];
+		// bytes equal to the EEPROM value are skipped
+		if(__start_sim_eeprom[ofs] != data) {
+			if(sim.ee_us < SIM_EE_WRITE_US)
+				return;
+			sim.ee_us -= SIM_EE_WRITE_US;
+			__start_sim_eeprom[ofs] = data;
+			sim.ee_writes++;
+			sim.ee_wear[ofs]++;
+		}
+		ee_seg_addr[i]++;
+		if(--ee_seg_len[i] == 0)
+			ee_seg_head++;
+		ee_que_head++;
+	}
+}
+
+// MCU reset: the write queue is lost.
+static void sim_ee_reset()
+{
+	EECR = 0;
+	ee_que_head = ee_que_tail;
+	ee_seg_head = ee_seg_tail;
+	sim.ee_us = 0;
+}
+
+static void sim_ee_file(const char *name, uint8_t save)
+{
+	FILE *f;
+	size_t n = __stop_sim_eeprom - __start_sim_eeprom;
+	if(name == NULL)
+		return;
+	f = fopen(name, save ? "wb" : "rb");
+	if(f == NULL) {
+		if(save)
+			fprintf(stderr, "sim: can't write %s\n", name);
+		return;
+	}
+	if(save)
+		fwrite(__start_sim_eeprom, 1, n, f);
+	else if(fread(__start_sim_eeprom, 1, n, f) != n)
+		fprintf(stderr, "sim: %s is not a %u byte EEPROM image\n", name, (unsigned)n);
+	fclose(f);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Time
+
+// Advances the time by n ticks, at most up to the next RTC tick.
+static void sim_advance(uint16_t n)
+{
+	uint64_t now = sim.tick + n;
+	if(DQ_A_IS_ON())
+		sim.work_ticks += n;
+	sim_ee_run((uint32_t)n * (1000000 / SIM_TICK_FREQ));
+	if((now / SIM_RTC_TICKS) != (sim.tick / SIM_RTC_TICKS))
+		TASK_FLAG_SET(RTC_TICK_FLAG);
+	sim.tick = now;
+	t_tick_src += n;
+	TASK_FLAG_SET(OS_TICK_UPD_FLAG);
+}
+
+// Runs until the tick count, skipping the ticks without the timer deadlines.
+static void sim_run_until(uint64_t tick)
+{
+	uint16_t n;
+	while(sim.tick < tick) {
+		n = SIM_RTC_TICKS - (uint16_t)(sim.tick % SIM_RTC_TICKS);
+		if(tick - sim.tick < n)
+			n = (uint16_t)(tick - sim.tick);
+		if(EECR & (1<<EERIE))
+			n = 1;
+		n = sim_tick_idle(n);
+		if(n == 0)
+			n = 1;
+		sim_advance(n);
+		sim_os_run();
+	}
+}
+
+// -------------------------------------------------------------------------------------------------
+// Script commands
+
+// Switch input change, PCINT0 sets the DI change flag (di_int.S).
+static void sim_di_set(uint8_t mask, uint8_t on)
+{
+	uint8_t pin = on ? (PINB & ~mask) : (PINB | mask);
+	if(pin == PINB)
+		return;
+	PINB = pin;
+	if((PCICR & (1<<PCIE0)) && (PCMSK0 & mask))
+		TASK_FLAG_SET(DI_CHANGE_FLAG);
+}
+
+static void sim_cnt_read(struct sim_cnt *c)
+{
+	c->starts = ro_get_num_starts();
+	c->flushes = ro_get_num_flushes();
+	c->filter_total = ro_get_filter_total_time();
+	c->filter_work = ro_get_filter_work_time();
+	c->on = ro_get_total_on_time();
+	c->run = ro_get_total_run_time();
+}
+
+static void sim_power_cut()
+{
+	struct sim_cnt a, b;
+	if(sim.pwr) {
+		ro_disable();
+		sim.pwr = 0;
+	}
+	sim_cnt_read(&a);
+	sim_ee_run(sim.holdup_us);
+	sim_ee_reset();
+	ro_load_ee();
+	sim_cnt_read(&b);
+	sim.cuts++;
+	if(memcmp(&a, &b, sizeof(struct sim_cnt)) != 0) {
+		fprintf(stderr, "power cut at %.3f days: counters lost, "
+			"starts %u -> %u, on %u -> %u, run %u -> %u\n",
+			sim.tick / (86400.0 * SIM_TICK_FREQ), a.starts, b.starts, a.on, b.on, a.run, b.run);
+		sim.errors++;
+	}
+}
+
+static void sim_cmd(const struct sim_ev *ev)
+{
+	uint8_t on = (strcmp(ev->arg, "1") == 0);
+	if(strcmp(ev->cmd, "inlet") == 0) {
+		sim_di_set(DI_A_N, on);
+	} else if(strcmp(ev->cmd, "refill") == 0) {
+		sim_di_set(DI_B_N, on);
+	} else if(strcmp(ev->cmd, "power") == 0) {
+		if(strcmp(ev->arg, "cut") == 0) {
+			sim_power_cut();
+		} else if((strcmp(ev->arg, "on") == 0) && !sim.pwr) {
+			ro_enable();
+			sim.pwr = 1;
+		} else if((strcmp(ev->arg, "off") == 0) && sim.pwr) {
+			ro_disable();
+			sim.pwr = 0;
+		}
+	} else if(strcmp(ev->cmd, "flush") == 0) {
+		ro_start_flush();
+	} else if(strcmp(ev->cmd, "reset") == 0) {
+		ro_reset();
+	} else if(strcmp(ev->cmd, "off") == 0) {
+		ro_set_off(on);
+	}
+	sim_os_run();
+}
+
+static int sim_load_script(const char *name)
+{
+	FILE *f = fopen(name, "r");
+	char line[128];
+	unsigned h, m, s, ln = 0;
+	struct sim_ev *ev;
+	if(f == NULL) {
+		fprintf(stderr, "sim: can't open %s\n", name);
+		return 0;
+	}
+	while(fgets(line, sizeof(line), f) != NULL) {
+		ln++;
+		if((line[strspn(line, " \t\r\n")] == '\0') || (line[strspn(line, " \t")] == '#'))
+			continue;
+		if(sim_ev_n == SIM_EV_MAX) {
+			fprintf(stderr, "%s:%u: too many lines\n", name, ln);
+			break;
+		}
+		ev = &sim_ev[sim_ev_n];
+		ev->arg[0] = '\0';
+		if((sscanf(line, "%u:%u:%u %15s %15s", &h, &m, &s, ev->cmd, ev->arg) < 4) ||
+			(h > 23) || (m > 59) || (s > 59))
+		{
+			fprintf(stderr, "%s:%u: expected hh:mm:ss command [arg]\n", name, ln);
+			fclose(f);
+			return 0;
+		}
+		ev->t = h * 3600 + m * 60 + s;
+		if((sim_ev_n != 0) && (ev->t < sim_ev[sim_ev_n - 1].t)) {
+			fprintf(stderr, "%s:%u: out of time order\n", name, ln);
+			fclose(f);
+			return 0;
+		}
+		sim_ev_n++;
+	}
+	fclose(f);
+	return 1;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+static void sim_boot(const char *ee_name)
+{
+	memset(__start_sim_eeprom, 0xFF, __stop_sim_eeprom - __start_sim_eeprom);
+	sim_ee_file(ee_name, 0);
+	PINB = 0xFF;				// switches off, pull-ups
+	task_data_init();
+	task_flag_bind(OS_TICK_UPD_FLAG_ID, &tick_upd_task, TASK_PRIORITY_NORMAL);
+	task_flag_bind(RTC_TICK_FLAG_ID, &rtc_tick_task, TASK_PRIORITY_NORMAL);
+	ee_set_done_task(&ee_done_task);
+	ro_load_ee();
+	sim.run_start = ro_get_total_run_time();
+	ro_enable();
+	sim.pwr = 1;
+	sim_os_run();
+}
+
+static void sim_report(uint32_t days, double wall)
+{
+	uint16_t i, wear_max = 0;
+	uint32_t run = ro_get_total_run_time() - sim.run_start;
+	uint32_t work = (uint32_t)(sim.work_ticks / SIM_TICK_FREQ);
+	for(i = 0; i < SIM_EE_SIZE; i++) {
+		if(sim.ee_wear[i] > sim.ee_wear[wear_max])
+			wear_max = i;
+	}
+	printf("simulated %u days in %.2f s, %.3g x real time\n",
+		days, wall, (days * 86400.0) / wall);
+	printf("task runs %llu, %.3g per s\n", (unsigned long long)sim.task_runs, sim.task_runs / wall);
+	printf("state changes %u, beeps %u, power cuts %u\n", sim.state_changes, sim.beeps, sim.cuts);
+	printf("starts %u, flushes %u, filter total %u s, filter work %u s, on %u s, run %u s\n",
+		ro_get_num_starts(), ro_get_num_flushes(), ro_get_filter_total_time(),
+		ro_get_filter_work_time(), ro_get_total_on_time(), ro_get_total_run_time());
+	printf("EEPROM bytes written %u, max %u writes at offset %u\n",
+		sim.ee_writes, sim.ee_wear[wear_max], wear_max);
+	// run time counter steps with t_rtc_sec (2s), each start and stop may be off by one step
+	printf("WORK output on %u s, run time counter %u s\n", work, run);
+	if((work > run + 2) && (work - run > 4 * (ro_get_num_starts() + 1))) {
+		printf("run time counter behind the WORK output\n");
+		sim.errors++;
+	}
+	if((run > work + 2) && (run - work > 4 * (ro_get_num_starts() + 1))) {
+		printf("run time counter ahead of the WORK output\n");
+		sim.errors++;
+	}
+	printf("%s\n", sim.errors ? "FAIL" : "ok");
+}
+
+int main(int argc, char **argv)
+{
+	const char *ee_name = NULL;
+	uint32_t days = 1, day;
+	uint16_t i;
+	int opt;
+	struct timespec t0, t1;
+
+	sim.holdup_us = 116000;
+	while((opt = getopt(argc, argv, "vd:h:e:")) != -1) {
+		switch(opt) {
+		case 'v': sim.verbose = 1; break;
+		case 'd': days = strtoul(optarg, NULL, 0); break;
+		case 'h': sim.holdup_us = strtoul(optarg, NULL, 0) * 1000; break;
+		case 'e': ee_name = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-v] [-d days] [-h holdup_ms] [-e eeprom.bin] script\n", argv[0]);
+			return 2;
+		}
+	}
+	if((optind != argc - 1) || !sim_load_script(argv[optind]))
+		return 2;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	sim_boot(ee_name);
+	for(day = 0; day < days; day++) {
+		for(i = 0; i < sim_ev_n; i++) {
+			sim_run_until(((uint64_t)day * 86400 + sim_ev[i].t) * SIM_TICK_FREQ);
+			sim_cmd(&sim_ev[i]);
+		}
+	}
+	sim_run_until((uint64_t)days * 86400 * SIM_TICK_FREQ);
+	// drain the write queue before saving the image
+	if(sim.pwr) {
+		ro_disable();
+		sim.pwr = 0;
+	}
+	sim_run_until(sim.tick + SIM_RTC_TICKS);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	sim_report(days, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9);
+	sim_ee_file(ee_name, 1);
+	return sim.errors ? 1 : 0;
+}
+
+// -------------------------------------------------------------------------------------------------
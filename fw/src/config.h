@@ -4,12 +4,32 @@
 
 // -------------------------------------------------------------------------------------------------
 
-#define BTN_LONGPUSH_THRES				576		// 48ms*12
+#define BTN_LONGPUSH_THRES				576		// ms
 
 #define VIN_DROP						3000	// Diode drop 0.75V*4
 #define VIN_THRES_PWRDOWN				15000	// Pwr down when below 15V
 #define VIN_THRES_PWRUP					21000	// Pwr up when above 21V
 
+// Save the changed counters on power off (VIN below VIN_THRES_PWRDOWN). Comment to disable.
+// Write queue space for the record is reserved while the controller runs, the record is queued
+// ahead of the other writes.
+// Commit time budget, from VIN crossing the threshold:
+//   detection: ADC refresh 48ms + sweep 2*8 samples * 104us = 50ms max
+//   commit: byte in progress and 33 bytes data ring record * 3.4ms EEPROM write = 116ms max
+// Supply must hold the MCU up for ~166ms after VIN drops below VIN_THRES_PWRDOWN.
+// Estimate from the datasheet write and ADC conversion times, not measured on the board.
+// A record cut by the power loss fails the CRC check, the previous record is loaded then.
+#define RO_PWRFAIL_SAVE
+
+// Counters are saved to the data ring log every RO_DATA_SAVE_INTERVAL seconds, if changed.
+// Each slot is written once per RO_DATA_RING_N saves: 10 min and 16 slots give
+// 9 writes per day per cell, 30 years for the 100k cycles EEPROM endurance.
+#define RO_DATA_SAVE_INTERVAL			600		// sec
+#define RO_DATA_RING_N					16		// 16 * 33 bytes
+
+// State transition log, 32-byte blocks of 2..6 byte events (~80 events for 10 blocks).
+#define RO_LOG_BLOCKS					10
+
 #define RO_CFG_MAN_FLUSH_TIME			900		// P00 0..60/1 min
 #define RO_CFG_AUTO_FLUSH_TIME			60		// P01 0..900/10 sec
 #define RO_CFG_FLUSH_WORK_THRES			7200	// P02 0..990/10 min
@@ -18,4 +38,23 @@
 #define RO_CFG_NOWATER_THRES			5		// P05 0..60/1 sec
 #define RO_CFG_EXTRA_TIME				30		// P06 0..360/5 sec
 
+// Run RO controller on the switch change and deadline events. Comment to poll every 48ms.
+#define RO_EVENT_DRIVEN
+
+// Run the CPU at F_CPU/8, full speed for the button handling and the data commits (clk.h).
+// Comment to run at F_CPU.
+#define CLK_SCALING
+
+// Energy accounting: time per sleep mode and peripheral on-time, charge estimate (energy.h).
+// Adds ~100 CPU cycles per wakeup. Comment to disable.
+//#define ENERGY_ACCT
+
+// Current draw estimates for the energy accounting, uA at 5V. Rough datasheet and board figures,
+// measure the board to refine. Modes are at the low-speed clock (CLK_SCALING), the peripherals
+// add to the mode current.
+//                               active idle  ADC  psave stdby
+#define ENERGY_UA_MODE			{ 450,  150,  120,  2,    200 }
+//                               disp   buzz  ADC  WORK   BYPASS LAMP   full speed
+#define ENERGY_UA_PER			{ 12000, 3000, 250, 25000, 25000, 25000, 1800 }
+
 // -------------------------------------------------------------------------------------------------
@@ -3,6 +3,21 @@
 
 #pragma once
 
+// -------------------------------------------------------------------------------------------------
+// System clock
+
+// CPU clock prescaler (CLKPR): F_CPU at full speed, F_CPU/CLK_SLOW_DIV at low speed.
+// Timer0, Timer1 and ADC clocks are kept the same at both speeds (clk.c).
+#define CLK_FAST_PS			1		// clock_div_2, 4MHz
+#define CLK_SLOW_PS			4		// clock_div_16, 500kHz
+#define CLK_SLOW_DIV		8
+#define CLK_IS_SLOW()		(CLKPR == CLK_SLOW_PS)
+
+// Idle periods shorter than this (ticks) use extended standby instead of power save.
+// Extended standby keeps the main oscillator running, it pays off with a crystal only:
+// internal RC oscillator wakes up from power save in 6 CK. 0 to disable.
+#define SLEEP_STANDBY_TICKS	0
+
 // -------------------------------------------------------------------------------------------------
 // Discrete input
 
@@ -13,6 +28,17 @@
 #define DI_A_IS_ON()		!(DI_PIN & DI_A_N)
 #define DI_B_IS_ON()		!(DI_PIN & DI_B_N)
 
+// PCINT0 -> Discrete input change (PCINT0..1)
+#define DI_INT_ENABLE() do {						\
+		PCMSK0 |= (1<<PCINT0)|(1<<PCINT1);			\
+		PCIFR = 1<<PCIF0;							\
+		PCICR |= 1<<PCIE0;							\
+	} while(0)
+#define DI_INT_DISABLE() do {						\
+		PCICR &= ~(1<<PCIE0);						\
+		PCMSK0 &= ~((1<<PCINT0)|(1<<PCINT1));		\
+	} while(0)
+
 // -------------------------------------------------------------------------------------------------
 // Discrete output
 
@@ -82,6 +108,21 @@
 	} while(0)
 #define BTN_IS_PSH()		!(BTN_PIN & BTN_N)
 
+// PCINT2 -> Button change (PCINT16)
+#define BTN_INT_ENABLE() do {			\
+		PCMSK2 |= 1<<PCINT16;			\
+		PCIFR = 1<<PCIF2;				\
+		PCICR |= 1<<PCIE2;				\
+	} while(0)
+#define BTN_INT_DISABLE() do {			\
+		PCICR &= ~(1<<PCIE2);			\
+		PCMSK2 &= ~(1<<PCINT16);		\
+	} while(0)
+
+// Edge timestamp: RTC counter, 32768/256 Hz
+#define BTN_STAMP_REG		TCNT2
+#define BTN_STAMP_FREQ		128
+
 // -------------------------------------------------------------------------------------------------
 // Buzzer (3.2kHz)
 
@@ -92,12 +133,13 @@
 #define BUZZ_OFF()			TCCR1A &= ~(1<<COM1B1)
 #define BUZZ_IS_ON()		(TCCR1A & (1<<COM1B1))
 
-// Timer1:FastPWM(TOP=OCR1A) @ F_CPU
+// Timer1:FastPWM(TOP=OCR1A) @ CPU clock
 // OC1B -> Buzzer
+#define BUZZ_TOP()			((CLK_IS_SLOW() ? F_CPU/CLK_SLOW_DIV : F_CPU)/BUZZ_FREQ-1)
 #define BUZZ_ENABLE() do {							\
 		PRR &= ~(1<<PRTIM1);						\
-		OCR1A = F_CPU/BUZZ_FREQ-1;					\
-		OCR1B = F_CPU/BUZZ_FREQ/2;					\
+		OCR1A = BUZZ_TOP();							\
+		OCR1B = (BUZZ_TOP()+1)/2;					\
 		TCCR1A = (1<<WGM11)|(1<<WGM10);				\
 		TCCR1B = (1<<WGM13)|(1<<WGM12)|(1<<CS10);	\
 	} while(0)
@@ -107,21 +149,37 @@
 		PRR |= 1<<PRTIM1;							\
 	} while(0)
 
+// Timer1:Normal @ F_CPU/8
+// Task profiling counter (OS_TASK_PROF), buzzer is muted then.
+#define PROF_CNT_DIV		8
+#define PROF_CNT_INIT() do {						\
+		PRR &= ~(1<<PRTIM1);						\
+		TCCR1A = 0;									\
+		TCCR1B = 1<<CS11;							\
+	} while(0)
+#define PROF_CNT_READ()		TCNT1
+
 // -------------------------------------------------------------------------------------------------
 
-// Timer0:Normal @ F_CPU/64
-// OC0A -> Sys tick and Display
-#define TICK_DISP_ENABLE() do {						\
+// Timer0:Normal @ F_CPU/64 (CPU clock/64 or CPU clock/8 at low speed)
+// OC0A -> Display refresh (1.6ms)
+#define DISP_CS()			(CLK_IS_SLOW() ? (1<<CS01) : (1<<CS01)|(1<<CS00))
+#define DISP_ENABLE() do {							\
 		PRR &= ~(1<<PRTIM0);						\
-		TCCR0B = (1<<CS01)|(1<<CS00);				\
+		TCNT0 = 0;									\
+		OCR0A = 100;								\
+		TIFR0 = 1<<OCF0A;							\
 		TIMSK0 = 1<<OCIE0A;							\
+		TCCR0B = DISP_CS();							\
 	} while(0)
-#define TICK_DISP_DISABLE() do {					\
+#define DISP_DISABLE() do {							\
 		TCCR0B = 0;									\
+		TIMSK0 = 0;									\
 		PRR |= 1<<PRTIM0;							\
 		SEG_WRITE(0);								\
 		SEL_OFF();									\
 	} while(0)
+#define DISP_IS_ON()		(TCCR0B != 0)
 
 // -------------------------------------------------------------------------------------------------
 
@@ -139,12 +197,58 @@
 		TIMSK2 = 1<<TOIE2;							\
 	} while(0)
 
+// Timer2:Async @ F_32K/256
+// OC2B -> Sys tick, every count (7.8ms). OCR2B is advanced by the interrupt.
+// TICK_START(cnt): first tick at Timer2 count cnt. OCR2B latches up to 2 TOSC1 cycles after
+// the write, so cnt must be at least 2 counts after the synced TCNT2 or the match may be missed.
+#define TICK_START(cnt) do {						\
+		OCR2B = t_tick_cmp = (cnt);					\
+		while(ASSR & (1<<OCR2BUB))					\
+			;										\
+		TIFR2 = 1<<OCF2B;							\
+		TIMSK2 |= 1<<OCIE2B;						\
+	} while(0)
+#define TICK_STOP() do {							\
+		TIMSK2 &= ~(1<<OCIE2B);						\
+	} while(0)
+#define TICK_IS_ON()		(TIMSK2 & (1<<OCIE2B))
+#define TICK_ENABLE() do {							\
+		RTC_SLEEP_SYNC();							\
+		TICK_START(TCNT2 + 2);						\
+	} while(0)
+#define TICK_DISABLE()		TICK_STOP()
+
+// Timer2:Async @ F_32K/256
+// OC2A -> Tickless idle wakeup
+#define TICKLESS_WAKE_SET(cnt) do {					\
+		OCR2A = (cnt);								\
+		while(ASSR & (1<<OCR2AUB))					\
+			;										\
+		TIFR2 = 1<<OCF2A;							\
+		TIMSK2 |= 1<<OCIE2A;						\
+	} while(0)
+#define TICKLESS_WAKE_CLR() do {					\
+		TIMSK2 &= ~(1<<OCIE2A);						\
+	} while(0)
+
+// Timer2 interrupt logic needs one TOSC1 cycle to reset after the wakeup,
+// wait for a register update before entering power save again.
+// Also syncs TCNT2 for reading after the wakeup.
+#define RTC_SLEEP_SYNC() do {						\
+		TCCR2A = 0;									\
+		while(ASSR & (1<<TCR2AUB))					\
+			;										\
+	} while(0)
+
 // -------------------------------------------------------------------------------------------------
 // ADC
 
 #define ADMUX_AIN_C			((1<<REFS1)|(1<<REFS0)|6)	// 5.00V FS
 #define ADMUX_VDC			((1<<REFS1)|(1<<REFS0)|7)	// 51.2V FS
 
+// ADC clock F_CPU/2^ps (ADPS), CPU clock/2^(ps-3) at low speed
+#define ADC_PS(ps)			(CLK_IS_SLOW() ? (ps)-3 : (ps))
+
 // -------------------------------------------------------------------------------------------------
 
 //#define PORTB_INIT		(0)
@@ -30,6 +30,19 @@ static uint16_t adc_res[ADC_NCH];
 static uint8_t adc_ch_cur;
 static adc_callback_t adc_callback;
 
+#ifdef ADC_REFRESH_MS
+static void adc_refresh(struct tmr_oneshot *tmr)
+{
+	adc_start(adc_ch_mux[0]);
+}
+
+#ifndef OS_TMR_SLACK
+static struct tmr_oneshot adc_refresh_tmr = TMR_ONESHOT(adc_refresh);
+#else // OS_TMR_SLACK
+static struct tmr_oneshot adc_refresh_tmr = TMR_ONESHOT_SLACK(adc_refresh, T_MS(ADC_REFRESH_MS / 4));
+#endif // OS_TMR_SLACK
+#endif // ADC_REFRESH_MS
+
 static void adc_buf_done(struct task_handle *task)
 {
 	adc_res[adc_ch_cur++] = adc_read_res();
@@ -39,20 +52,26 @@ static void adc_buf_done(struct task_handle *task)
 		// adc refresh can be disabled by the callback
 		if(!(ADCSRA & (1<<ADEN)))
 			return;
+#ifdef ADC_REFRESH_MS
+		// start the next refresh cycle by the timer
+		tmr_oneshot_set(&adc_refresh_tmr, TMR_UNIT_TICK, T_MS(ADC_REFRESH_MS));
+		return;
+#endif // ADC_REFRESH_MS
 	}
 	adc_start(adc_ch_mux[adc_ch_cur]);
 }
 
 // -------------------------------------------------------------------------------------------------
 
+struct task_handle adc_buf_done_task = TASK_HANDLE(adc_buf_done);
+
 void adc_read_enable(adc_callback_t callback)
 {
-	static struct task_handle adc_buf_done_task = TASK_HANDLE(adc_buf_done);
 	task_flag_bind(ADC_BUF_DONE_FLAG_ID, &adc_buf_done_task, TASK_PRIORITY_NORMAL);
 	adc_callback = callback;
 
 	ADMUX = adc_ch_mux[0];
-	ADCSRA = (1<<ADEN)|(1<<ADIE)|(1<<ADPS2)|(1<<ADPS1); // F_CPU/32
+	ADCSRA = (1<<ADEN)|(1<<ADIE)|ADC_PS(6); // F_CPU/64
 
 	adc_ch_cur = 0;
 	adc_start(adc_ch_mux[0]);
@@ -60,6 +79,9 @@ void adc_read_enable(adc_callback_t callback)
 
 void adc_read_disable()
 {
+#ifdef ADC_REFRESH_MS
+	tmr_oneshot_cancel(&adc_refresh_tmr);
+#endif // ADC_REFRESH_MS
 	ADCSRA = 0;
 	ADMUX = 0;
 }
@@ -70,7 +92,7 @@ uint16_t adc_read_single(uint8_t mux)
 {
 	uint16_t data;
 	ADMUX = mux;
-	ADCSRA = (1<<ADEN)|(1<<ADPS2); // F_CPU/16
+	ADCSRA = (1<<ADEN)|ADC_PS(4); // F_CPU/16
 	ADCSRA |= 1<<ADSC; loop_until_bit_is_set(ADCSRA, ADIF);
 	ADCSRA |= 1<<ADSC; loop_until_bit_is_set(ADCSRA, ADIF);
 	data = ADC;
@@ -11,6 +11,11 @@
 
 #define ADC_NSAMP		8
 
+// Continuous read refresh period, ms. Comment to restart the conversions immediately.
+// Refresh runs while powered, display blank or not: it wakes the MCU every 48..60ms, so the
+// tickless idle sleeps ~6 ticks max then. It also sets the VIN power fail detection latency.
+#define ADC_REFRESH_MS	48
+
 #ifndef __ASSEMBLER__
 
 // Continuous read channel list
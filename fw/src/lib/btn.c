@@ -0,0 +1,127 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "os/os.h"
+#include "btn.h"
+#include "../config.h"
+#include "../hwconf.h"
+
+// -------------------------------------------------------------------------------------------------
+
+enum {
+	BTN_STATE_RELEASED,
+	BTN_STATE_PUSHED,
+	BTN_STATE_LONGPUSHED,
+};
+
+// First edge timestamp, RTC counter. Set by the interrupt when unlocked.
+volatile uint8_t btn_edge_stamp;
+volatile uint8_t btn_edge_lock;
+
+static uint8_t btn_st;
+static struct task_handle *btn_task;
+
+static uint8_t btn_ev_que[BTN_EV_QUE_LEN];
+static uint8_t btn_ev_head;
+static uint8_t btn_ev_tail;
+
+// -------------------------------------------------------------------------------------------------
+// Event queue
+
+static void btn_ev_put(uint8_t ev)
+{
+	// drop the event if queue is full
+	if((uint8_t)(btn_ev_tail - btn_ev_head) < BTN_EV_QUE_LEN)
+		btn_ev_que[btn_ev_tail++ & (BTN_EV_QUE_LEN - 1)] = ev;
+	task_schedule(btn_task, TASK_PRIORITY_NORMAL);
+}
+
+uint8_t btn_ev_get()
+{
+	if(btn_ev_head == btn_ev_tail)
+		return BTN_EV_NONE;
+	return btn_ev_que[btn_ev_head++ & (BTN_EV_QUE_LEN - 1)];
+}
+
+// -------------------------------------------------------------------------------------------------
+// Edge processing
+
+static void btn_longpush(struct tmr_oneshot *tmr)
+{
+	btn_st = BTN_STATE_LONGPUSHED;
+	btn_ev_put(BTN_EV_LONGPUSH);
+}
+
+static struct tmr_oneshot btn_longpush_tmr = TMR_ONESHOT(btn_longpush);
+
+// Debounce time passed since the last edge
+static void btn_settle(struct tmr_oneshot *tmr)
+{
+	uint8_t el;
+	uint16_t d;
+
+	// ticks since the first edge, unlock the edge timestamp
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		el = BTN_STAMP_REG - btn_edge_stamp;
+		btn_edge_lock = 0;
+	}
+	d = el * T_MS(1000) / BTN_STAMP_FREQ;
+
+	if(BTN_IS_PSH()) {
+		if(btn_st != BTN_STATE_RELEASED)
+			return;
+		btn_st = BTN_STATE_PUSHED;
+		btn_ev_put(BTN_EV_PRESS);
+		d = (d < T_MS(BTN_LONGPUSH_THRES)) ? (T_MS(BTN_LONGPUSH_THRES) - d) : 0;
+		tmr_oneshot_set(&btn_longpush_tmr, TMR_UNIT_TICK, d);
+	} else {
+		if(btn_st == BTN_STATE_RELEASED)
+			return;
+		if(btn_st == BTN_STATE_PUSHED) {
+			tmr_oneshot_cancel(&btn_longpush_tmr);
+			btn_ev_put(BTN_EV_PUSH);
+		}
+		btn_st = BTN_STATE_RELEASED;
+	}
+}
+
+static struct tmr_oneshot btn_settle_tmr = TMR_ONESHOT(btn_settle);
+
+// Pin change, restart the debounce time
+static void btn_edge(struct task_handle *task)
+{
+	tmr_oneshot_set(&btn_settle_tmr, TMR_UNIT_TICK, T_MS(BTN_DEBOUNCE_MS));
+}
+
+// -------------------------------------------------------------------------------------------------
+
+struct task_handle btn_edge_task = TASK_HANDLE(btn_edge);
+
+void btn_enable(struct task_handle *task)
+{
+	btn_task = task;
+	btn_st = BTN_STATE_RELEASED;
+	btn_ev_head = 0;
+	btn_ev_tail = 0;
+	btn_edge_lock = 0;
+
+	BTN_ENABLE();
+	task_flag_bind(BTN_EDGE_FLAG_ID, &btn_edge_task, TASK_PRIORITY_NORMAL);
+	BTN_INT_ENABLE();
+}
+
+void btn_disable()
+{
+	BTN_INT_DISABLE();
+	task_flag_unbind(BTN_EDGE_FLAG_ID);
+	tmr_oneshot_cancel(&btn_settle_tmr);
+	tmr_oneshot_cancel(&btn_longpush_tmr);
+	BTN_DISABLE();
+
+	btn_st = BTN_STATE_RELEASED;
+	btn_ev_head = 0;
+	btn_ev_tail = 0;
+}
+
+// -------------------------------------------------------------------------------------------------
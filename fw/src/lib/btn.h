@@ -0,0 +1,38 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+#include "os/os.h"
+#endif // __ASSEMBLER__
+
+// -------------------------------------------------------------------------------------------------
+
+// Contact debounce time, ms. Button state is sampled this time after the last edge.
+#define BTN_DEBOUNCE_MS		24
+
+// Event queue length, power of 2.
+#define BTN_EV_QUE_LEN		4
+
+#ifndef __ASSEMBLER__
+
+// Button events
+enum {
+	BTN_EV_NONE,
+	BTN_EV_PRESS,		// button pressed down
+	BTN_EV_PUSH,		// button released before the long push threshold
+	BTN_EV_LONGPUSH,	// button held for the long push threshold
+};
+
+// Button driver: pin change interrupt timestamps the first edge with the RTC counter,
+// button state is sampled after the debounce time. Task is scheduled on every queued event.
+void btn_enable(struct task_handle *task);
+void btn_disable();
+
+// Returns the next queued event, BTN_EV_NONE if queue is empty.
+uint8_t btn_ev_get();
+
+#endif // __ASSEMBLER__
+
+// -------------------------------------------------------------------------------------------------
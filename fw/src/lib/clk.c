@@ -0,0 +1,66 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <avr/power.h>
+#include <avr/interrupt.h>
+#include "os/os.h"
+#include "clk.h"
+#include "energy.h"
+#include "../hwconf.h"
+
+// -------------------------------------------------------------------------------------------------
+
+#ifdef CLK_SCALING
+
+// Task profiling counter runs on the CPU clock, keep the full speed then.
+#ifndef OS_TASK_PROF
+  #define CLK_BASE_PS		CLK_SLOW_PS
+#else // OS_TASK_PROF
+  #define CLK_BASE_PS		CLK_FAST_PS
+#endif // OS_TASK_PROF
+
+static uint8_t clk_fast_cnt = 1;	// boot runs at full speed (mcu_init)
+
+// Switches the CPU clock and the peripheral prescalers.
+// Timer0 count may slip by up to 1 count (16us) on the switch.
+static void clk_set(uint8_t ps)
+{
+	uint8_t sreg, adps;
+	if(CLKPR == ps)
+		return;
+	sreg = SREG;
+	cli();
+	clock_prescale_set((clock_div_t)ps);
+	// Timer0 @ F_CPU/64, if not stopped
+	if(TCCR0B != 0)
+		TCCR0B = DISP_CS();
+	// Timer1 buzzer tone, if enabled
+	if(TCCR1B & (1<<CS10)) {
+		OCR1A = BUZZ_TOP();
+		OCR1B = (BUZZ_TOP()+1)/2;
+	}
+	// ADC clock, ADIF is not cleared
+	if(ADCSRA & (1<<ADEN)) {
+		adps = ADCSRA & 0x07;
+		adps = (ps == CLK_SLOW_PS) ? adps - 3 : adps + 3;
+		ADCSRA = (ADCSRA & ~((1<<ADIF)|0x07)) | adps;
+	}
+	SREG = sreg;
+	energy_set(EN_CLK_FAST, ps == CLK_FAST_PS);
+}
+
+void clk_fast_begin()
+{
+	if(clk_fast_cnt++ == 0)
+		clk_set(CLK_FAST_PS);
+}
+
+void clk_fast_end()
+{
+	if(--clk_fast_cnt == 0)
+		clk_set(CLK_BASE_PS);
+}
+
+#endif // CLK_SCALING
+
+// -------------------------------------------------------------------------------------------------
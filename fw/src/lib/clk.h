@@ -0,0 +1,26 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include "../config.h"
+
+// -------------------------------------------------------------------------------------------------
+// CPU clock scaling: the CPU runs at F_CPU/CLK_SLOW_DIV, full speed is requested for the bursts.
+// Timer0 (display), Timer1 (buzzer) and ADC prescalers are switched with the clock,
+// so display and buzzer timing do not change. Boot runs at full speed until clk_fast_end.
+
+#ifdef CLK_SCALING
+
+// Requests the full speed until the matching clk_fast_end. Calls can be nested.
+void clk_fast_begin();
+void clk_fast_end();
+
+#else // CLK_SCALING
+
+#define clk_fast_begin()
+#define clk_fast_end()
+
+#endif // CLK_SCALING
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "disp.h"
+#include "energy.h"
+#include "../hwconf.h"
+
+// -------------------------------------------------------------------------------------------------
+
+uint8_t disp_buf[DISP_N];
+
+// Port image frames, read by the interrupt.
+// Frame is swapped in at the end of the current one, disp_swap is cleared then.
+uint8_t disp_img[2][DISP_N][DISP_IMG_N];
+uint8_t *disp_ptr;				// image of the next digit
+uint8_t *disp_next;				// frame to swap in
+uint8_t disp_cyc;				// digits left in the current frame
+volatile uint8_t disp_swap;		// nonzero if disp_next is pending
+
+static uint8_t disp_front;		// frame shown or pending
+
+static const uint8_t disp_sel[DISP_N] = { SEL_0_P, SEL_1_P, SEL_2_P };
+
+// -------------------------------------------------------------------------------------------------
+
+void disp_commit()
+{
+	uint8_t i, k, on = 0;
+	uint8_t *img;
+
+	// back frame: the pending frame if not swapped in yet, the other one otherwise
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(!disp_swap)
+			disp_front ^= 1;
+		disp_swap = 0;
+	}
+	i = disp_front;
+	img = disp_img[i][0];
+	for(k = 0; k < DISP_N; k++) {
+		img[0] = disp_buf[k] & SEG_3_0_P;
+		img[1] = disp_buf[k] & SEG_7_4_P;
+		img[2] = disp_sel[k];
+		img += DISP_IMG_N;
+		on |= disp_buf[k];
+	}
+
+	if(DISP_IS_ON()) {
+		disp_next = disp_img[i][0];
+		disp_swap = 1;
+	} else {
+		// refresh is stopped, start with the new frame
+		disp_ptr = disp_img[i][0];
+		disp_cyc = DISP_N;
+	}
+
+	// refresh runs only while something is shown
+	on = (on != 0);
+	if(on == (DISP_IS_ON() != 0))
+		return;
+	if(on)
+		DISP_ENABLE();
+	else
+		DISP_DISABLE();
+	energy_set(EN_DISP, on);
+}
+
+// -------------------------------------------------------------------------------------------------
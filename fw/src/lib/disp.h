@@ -64,10 +64,17 @@
 // 7-segment display
 
 #define DISP_N			3
+#define DISP_IMG_N		3		// port image bytes per digit: SEG_3_0, SEG_7_4, SEL
 
 #ifndef __ASSEMBLER__
+  // Drawing buffer, shown by disp_commit.
   extern uint8_t disp_buf[DISP_N];
   extern const uint8_t sseg_digit[10] PROGMEM;
+
+  // Shows the drawing buffer. Port images are precomputed to the back frame, the refresh
+  // interrupt swaps it in at the end of the current frame, so no half-drawn value is shown.
+  // Refresh runs only while something is shown.
+  void disp_commit();
 #endif // __ASSEMBLER__
 
 // -------------------------------------------------------------------------------------------------
@@ -0,0 +1,153 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "os/os.h"
+#include "ee.h"
+
+// -------------------------------------------------------------------------------------------------
+
+// Write queue, read by the interrupt.
+// Data bytes and segments (address, length) of the consecutive bytes.
+uint8_t ee_que_data[EE_QUE_LEN];
+volatile uint8_t ee_que_head;
+volatile uint8_t ee_que_tail;
+uint16_t ee_seg_addr[EE_SEG_LEN];
+uint8_t ee_seg_len[EE_SEG_LEN];
+volatile uint8_t ee_seg_head;
+volatile uint8_t ee_seg_tail;
+
+// Reserved queue bytes and segments
+static uint8_t ee_rsv_len;
+static uint8_t ee_rsv_seg;
+
+// Priority writes: on flag, queued bytes and segments ahead of the other writes
+static uint8_t ee_pri_on;
+static uint8_t ee_pri_len;
+static uint8_t ee_pri_seg;
+
+// -------------------------------------------------------------------------------------------------
+
+uint8_t ee_write(void *addr, const void *src, uint8_t len)
+{
+	uint8_t i, tail, seg;
+	if(len == 0)
+		return 1;
+	if(ee_free(1) < len)
+		return 0;
+	if(ee_pri_on) {
+		// interrupt is off: move the earlier priority writes len bytes and one segment towards
+		// the head, the new write goes after them, ahead of the other queued writes
+		tail = ee_que_head - len;
+		for(i = 0; i < ee_pri_len; i++, tail++)
+			ee_que_data[tail & (EE_QUE_LEN - 1)] = ee_que_data[(uint8_t)(tail + len) & (EE_QUE_LEN - 1)];
+		seg = ee_seg_head - 1;
+		for(i = 0; i < ee_pri_seg; i++, seg++) {
+			ee_seg_addr[seg & (EE_SEG_LEN - 1)] = ee_seg_addr[(uint8_t)(seg + 1) & (EE_SEG_LEN - 1)];
+			ee_seg_len[seg & (EE_SEG_LEN - 1)] = ee_seg_len[(uint8_t)(seg + 1) & (EE_SEG_LEN - 1)];
+		}
+		ee_que_head -= len;
+		ee_seg_head--;
+		ee_pri_len += len;
+		ee_pri_seg++;
+	} else {
+		tail = ee_que_tail;
+		seg = ee_seg_tail;
+	}
+	ee_seg_addr[seg & (EE_SEG_LEN - 1)] = (uint16_t)addr;
+	ee_seg_len[seg & (EE_SEG_LEN - 1)] = len;
+	while(len--) {
+		ee_que_data[tail & (EE_QUE_LEN - 1)] = *(const uint8_t*)src;
+		src = (const uint8_t*)src + 1;
+		tail++;
+	}
+	if(ee_pri_on)
+		return 1;
+	// data first, segment is read by the interrupt when the tail is updated
+	ee_que_tail = tail;
+	ee_seg_tail++;
+	EECR |= 1<<EERIE;
+	return 1;
+}
+
+uint8_t ee_write_byte(uint8_t *addr, uint8_t val)
+{
+	return ee_write(addr, &val, 1);
+}
+
+uint8_t ee_write_dword(uint32_t *addr, uint32_t val)
+{
+	return ee_write(addr, &val, 4);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void ee_read(void *dst, const void *addr, uint8_t len)
+{
+	// writer interrupt must not change EEAR during the read
+	EECR &= ~(1<<EERIE);
+	eeprom_read_block(dst, addr, len);
+	if(ee_seg_head != ee_seg_tail)
+		EECR |= 1<<EERIE;
+}
+
+uint8_t ee_read_byte(const uint8_t *addr)
+{
+	uint8_t val;
+	ee_read(&val, addr, 1);
+	return val;
+}
+
+uint32_t ee_read_dword(const uint32_t *addr)
+{
+	uint32_t val;
+	ee_read(&val, addr, 4);
+	return val;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+uint8_t ee_free(uint8_t nseg)
+{
+	uint8_t n;
+	if((uint8_t)(ee_seg_tail - ee_seg_head) > EE_SEG_LEN - nseg - ee_rsv_seg)
+		return 0;
+	n = EE_QUE_LEN - (uint8_t)(ee_que_tail - ee_que_head);
+	return (n > ee_rsv_len) ? (n - ee_rsv_len) : 0;
+}
+
+void ee_reserve(uint8_t len, uint8_t nseg)
+{
+	ee_rsv_len = len;
+	ee_rsv_seg = nseg;
+}
+
+void ee_priority(uint8_t on)
+{
+	if(on) {
+		// byte in progress is already out of the queue, interrupt can't take the next one
+		EECR &= ~(1<<EERIE);
+		ee_pri_len = 0;
+		ee_pri_seg = 0;
+		ee_pri_on = 1;
+	} else {
+		ee_pri_on = 0;
+		if(ee_seg_head != ee_seg_tail)
+			EECR |= 1<<EERIE;
+	}
+}
+
+uint8_t ee_busy()
+{
+	return (ee_seg_head != ee_seg_tail) || (EECR & (1<<EEPE));
+}
+
+void ee_set_done_task(struct task_handle *task)
+{
+	if(task != NULL)
+		task_flag_bind(EE_DONE_FLAG_ID, task, TASK_PRIORITY_NORMAL);
+	else
+		task_flag_unbind(EE_DONE_FLAG_ID);
+}
+
+// -------------------------------------------------------------------------------------------------
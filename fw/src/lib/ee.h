@@ -0,0 +1,54 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+#include "os/os.h"
+#endif // __ASSEMBLER__
+
+// -------------------------------------------------------------------------------------------------
+
+// Write queue length in bytes, power of 2, max 128.
+#define EE_QUE_LEN		128
+
+// Write queue length in segments (consecutive bytes of an ee_write call), power of 2.
+#define EE_SEG_LEN		16
+
+#ifndef __ASSEMBLER__
+
+// EEPROM writer: queued bytes are written in background, one byte per EE_READY interrupt.
+// Bytes already equal to the queued value are skipped.
+
+// Queues len bytes for write. Returns zero if queue has no space, nothing is queued then.
+uint8_t ee_write(void *addr, const void *src, uint8_t len);
+uint8_t ee_write_byte(uint8_t *addr, uint8_t val);
+uint8_t ee_write_dword(uint32_t *addr, uint32_t val);
+
+// Reads EEPROM. Waits for the current byte write, queued bytes are not yet in EEPROM.
+void ee_read(void *dst, const void *addr, uint8_t len);
+uint8_t ee_read_byte(const uint8_t *addr);
+uint32_t ee_read_dword(const uint32_t *addr);
+
+// Returns the number of free write queue bytes, zero if less than nseg segments are free.
+// Reserved bytes and segments are not free.
+uint8_t ee_free(uint8_t nseg);
+
+// Reserves len bytes and nseg segments of the write queue, other writes can't take them.
+// ee_reserve(0, 0) releases the reserve for the write it was kept for.
+void ee_reserve(uint8_t len, uint8_t nseg);
+
+// Priority writes: between ee_priority(1) and ee_priority(0), ee_write queues the bytes ahead of
+// the earlier queued writes, right after the byte in progress, in the ee_write call order.
+// Writer interrupt is held off meanwhile, no ee_read then.
+void ee_priority(uint8_t on);
+
+// Returns nonzero if write queue is not empty or write is in progress.
+uint8_t ee_busy();
+
+// Sets the task scheduled when the write queue becomes empty. NULL to unset.
+void ee_set_done_task(struct task_handle *task);
+
+#endif // __ASSEMBLER__
+
+// -------------------------------------------------------------------------------------------------
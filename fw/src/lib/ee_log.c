@@ -0,0 +1,190 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <util/crc16.h>
+#include "ee.h"
+#include "ee_log.h"
+
+// -------------------------------------------------------------------------------------------------
+
+// Block header
+struct ee_log_hdr {
+	uint16_t seq;
+	uint32_t t;
+	uint8_t crc;
+};
+
+static uint8_t *ee_log_blk(struct ee_log *log, uint8_t blk)
+{
+	return log->base + (uint16_t)blk * EE_LOG_BLK_SIZE;
+}
+
+static uint8_t ee_log_hdr_crc(struct ee_log_hdr *hdr)
+{
+	uint8_t i, crc = 0;
+	for(i = 0; i < EE_LOG_HDR_SIZE - 1; i++)
+		crc = _crc8_ccitt_update(crc, ((uint8_t*)hdr)[i]);
+	return crc;
+}
+
+// Returns the sequence number distance a - b. Sequence numbers wrap at 0xFFFE.
+static uint16_t ee_log_seq_diff(uint16_t a, uint16_t b)
+{
+	return (a >= b) ? (a - b) : (a - b - 1);
+}
+
+// Reads the block header. Returns zero if header is not valid.
+static uint8_t ee_log_hdr_read(struct ee_log *log, uint8_t blk, struct ee_log_hdr *hdr)
+{
+	ee_read(hdr, ee_log_blk(log, blk), EE_LOG_HDR_SIZE);
+	return (hdr->seq != 0xFFFF) && (hdr->crc == ee_log_hdr_crc(hdr));
+}
+
+// Reads the event at pos. Returns the event length, zero at the end of block.
+static uint8_t ee_log_ev_read(struct ee_log *log, uint8_t blk, uint8_t pos, uint8_t *code, uint32_t *d)
+{
+	uint8_t *p = ee_log_blk(log, blk) + pos;
+	uint8_t b, n = 1, sh = 0;
+	if(pos >= EE_LOG_BLK_SIZE)
+		return 0;
+	ee_read(code, p, 1);
+	if(*code & 0x80)
+		return 0;
+	*d = 0;
+	do {
+		if((pos + n >= EE_LOG_BLK_SIZE) || (sh > 28))
+			return 0;
+		ee_read(&b, p + n, 1);
+		n++;
+		*d |= (uint32_t)(b & 0x7F) << sh;
+		sh += 7;
+	} while(b & 0x80);
+	return n;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void ee_log_load(struct ee_log *log, uint32_t t)
+{
+	uint8_t blk, n, code, found = 0;
+	uint32_t d;
+	struct ee_log_hdr hdr;
+
+	// current block: greatest sequence number, serial number arithmetic
+	for(blk = 0; blk < log->nblk; blk++) {
+		if(!ee_log_hdr_read(log, blk, &hdr))
+			continue;
+		if(!found || ((int16_t)(hdr.seq - log->seq) > 0)) {
+			log->blk = blk;
+			log->seq = hdr.seq;
+			log->t_last = hdr.t;
+			found = 1;
+		}
+	}
+	if(!found) {
+		log->blk = log->nblk - 1;
+		log->pos = EE_LOG_BLK_SIZE;
+		log->seq = 0xFFFF;
+		log->t_last = 0;
+	} else {
+		// skip the written events
+		log->pos = EE_LOG_HDR_SIZE;
+		while((n = ee_log_ev_read(log, log->blk, log->pos, &code, &d)) != 0) {
+			log->pos += n;
+			log->t_last += d;
+		}
+	}
+	log->t_ofs = log->t_last - t;
+}
+
+uint8_t ee_log_put(struct ee_log *log, uint8_t code, uint32_t t)
+{
+	uint8_t buf[6], n = 1, nblk;
+	uint8_t *p;
+	uint32_t lt = t + log->t_ofs;
+	uint32_t d = lt - log->t_last;
+	const uint8_t term = 0xFF;
+
+	// code, time delta
+	buf[0] = code;
+	do {
+		buf[n] = d & 0x7F;
+		d >>= 7;
+		if(d != 0)
+			buf[n] |= 0x80;
+		n++;
+	} while(d != 0);
+
+	// check space for the new block terminator, header, event
+	nblk = (log->pos + n > EE_LOG_BLK_SIZE);
+	if(ee_free(nblk ? 5 : 3) < (nblk ? EE_LOG_HDR_SIZE + 1 : 0) + n + 1)
+		return 0;
+
+	// new block: terminator first, so a valid new header never precedes the stale events
+	if(nblk) {
+		struct ee_log_hdr hdr;
+		log->blk = (log->blk < log->nblk - 1) ? (log->blk + 1) : 0;
+		log->seq = (log->seq != 0xFFFE) ? (log->seq + 1) : 0;
+		log->pos = EE_LOG_HDR_SIZE;
+		hdr.seq = log->seq;
+		hdr.t = log->t_last;
+		hdr.crc = ee_log_hdr_crc(&hdr);
+		ee_write(ee_log_blk(log, log->blk) + EE_LOG_HDR_SIZE, &term, 1);
+		ee_write(ee_log_blk(log, log->blk), &hdr, EE_LOG_HDR_SIZE);
+	}
+
+	// event: next terminator, delta, code
+	p = ee_log_blk(log, log->blk) + log->pos;
+	if(log->pos + n < EE_LOG_BLK_SIZE)
+		ee_write(p + n, &term, 1);
+	ee_write(p + 1, buf + 1, n - 1);
+	ee_write(p, buf, 1);
+	log->pos += n;
+	log->t_last = lt;
+	return 1;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void ee_log_first(struct ee_log *log, struct ee_log_iter *it)
+{
+	it->k = 0;
+	it->pos = 0;
+}
+
+uint8_t ee_log_next(struct ee_log *log, struct ee_log_iter *it, uint8_t *code, uint32_t *t)
+{
+	uint8_t blk, n;
+	uint32_t d;
+	struct ee_log_hdr hdr;
+
+	while(it->k < log->nblk) {
+		// from the block after the current one (oldest)
+		blk = log->blk + 1 + it->k;
+		if(blk >= log->nblk)
+			blk -= log->nblk;
+		if(it->pos == 0) {
+			// skip blocks not written in the last ring cycle
+			if( !ee_log_hdr_read(log, blk, &hdr) ||
+				(ee_log_seq_diff(log->seq, hdr.seq) >= log->nblk) )
+			{
+				it->k++;
+				continue;
+			}
+			it->t = hdr.t;
+			it->pos = EE_LOG_HDR_SIZE;
+		}
+		n = ee_log_ev_read(log, blk, it->pos, code, &d);
+		if(n != 0) {
+			it->pos += n;
+			it->t += d;
+			*t = it->t;
+			return 1;
+		}
+		it->k++;
+		it->pos = 0;
+	}
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
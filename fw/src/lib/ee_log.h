@@ -0,0 +1,49 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------------------------------------
+// EEPROM event log: timestamped 7-bit event codes appended to a ring of EEPROM blocks.
+// Block layout: 16-bit sequence number, 32-bit time of the block start, CRC8 of the above,
+// then events: code byte, time delta since the previous event (LSB first, 7 bits per byte,
+// bit 7 set if more bytes follow). 0xFF code byte terminates the block.
+// Event is written terminator first and code byte last, so a torn write drops the event only.
+// New block terminator is written before the header, stale events are never replayed.
+// Log time is t continued from the last logged event over the power cycles.
+
+#define EE_LOG_BLK_SIZE		32
+#define EE_LOG_HDR_SIZE		7
+
+struct ee_log {
+	uint8_t *base;			// EEPROM region, nblk * EE_LOG_BLK_SIZE bytes
+	uint8_t nblk;			// number of blocks
+	uint8_t blk;			// current block. internal use only.
+	uint8_t pos;			// write position in the current block. internal use only.
+	uint16_t seq;			// sequence number of the current block. internal use only.
+	uint32_t t_last;		// log time of the last event. internal use only.
+	uint32_t t_ofs;			// log time offset. internal use only.
+};
+
+#define EE_LOG(base, nblk)	{ (uint8_t*)(base), nblk, (nblk) - 1, EE_LOG_BLK_SIZE, 0xFFFF, 0, 0 }
+
+struct ee_log_iter {
+	uint8_t k;				// block counter from the oldest
+	uint8_t pos;			// read position in the block
+	uint32_t t;				// log time of the previous event
+};
+
+// Finds the write position. t is the current time.
+void ee_log_load(struct ee_log *log, uint32_t t);
+
+// Queues the event write. code must be 0..0x7F, t is the current time.
+// Returns zero if the write queue has no space, event is dropped then.
+uint8_t ee_log_put(struct ee_log *log, uint8_t code, uint32_t t);
+
+// Iterates the written events from the oldest to the newest.
+// ee_log_next returns zero if no more events.
+void ee_log_first(struct ee_log *log, struct ee_log_iter *it);
+uint8_t ee_log_next(struct ee_log *log, struct ee_log_iter *it, uint8_t *code, uint32_t *t);
+
+// -------------------------------------------------------------------------------------------------
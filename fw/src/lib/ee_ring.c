@@ -0,0 +1,94 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <util/crc16.h>
+#include "ee.h"
+#include "ee_ring.h"
+
+// -------------------------------------------------------------------------------------------------
+
+// Slot trailer
+struct ee_ring_trl {
+	uint8_t ver;
+	uint16_t seq;
+	uint16_t crc;
+};
+
+static uint8_t *ee_ring_slot(struct ee_ring *ring, uint8_t pos)
+{
+	return ring->base + (uint16_t)pos * EE_RING_SLOT_SIZE(ring->len);
+}
+
+static uint16_t ee_ring_crc(uint16_t crc, const void *ptr, uint8_t len)
+{
+	while(len--) {
+		crc = _crc_ccitt_update(crc, *(const uint8_t*)ptr);
+		ptr = (const uint8_t*)ptr + 1;
+	}
+	return crc;
+}
+
+// Reads the slot trailer, checks version and CRC.
+static uint8_t ee_ring_check(struct ee_ring *ring, uint8_t pos, struct ee_ring_trl *trl)
+{
+	uint8_t i, b;
+	uint16_t crc = 0xFFFF;
+	uint8_t *slot = ee_ring_slot(ring, pos);
+	ee_read(trl, slot + ring->len, sizeof(struct ee_ring_trl));
+	if(trl->ver != ring->ver)
+		return 0;
+	for(i = 0; i < ring->len; i++) {
+		ee_read(&b, slot + i, 1);
+		crc = _crc_ccitt_update(crc, b);
+	}
+	crc = ee_ring_crc(crc, trl, 3);
+	return crc == trl->crc;
+}
+
+uint8_t ee_ring_load(struct ee_ring *ring, void *dst)
+{
+	uint8_t pos, found = 0;
+	struct ee_ring_trl trl;
+
+	// newest record: greatest sequence number, serial number arithmetic
+	for(pos = 0; pos < ring->n; pos++) {
+		if(!ee_ring_check(ring, pos, &trl))
+			continue;
+		if(!found || ((int16_t)(trl.seq - ring->seq) > 0)) {
+			ring->pos = pos;
+			ring->seq = trl.seq;
+			found = 1;
+		}
+	}
+	if(!found) {
+		ring->pos = ring->n - 1;
+		ring->seq = 0xFFFF;
+		return 0;
+	}
+	ee_read(dst, ee_ring_slot(ring, ring->pos), ring->len);
+	return 1;
+}
+
+uint8_t ee_ring_save(struct ee_ring *ring, const void *src)
+{
+	uint8_t pos;
+	uint8_t *slot;
+	struct ee_ring_trl trl;
+
+	if(ee_free(2) < EE_RING_SLOT_SIZE(ring->len))
+		return 0;
+	pos = (ring->pos < ring->n - 1) ? (ring->pos + 1) : 0;
+	trl.ver = ring->ver;
+	trl.seq = ring->seq + 1;
+	if(trl.seq == 0xFFFF)
+		trl.seq = 0;
+	trl.crc = ee_ring_crc(ee_ring_crc(0xFFFF, src, ring->len), &trl, 3);
+	slot = ee_ring_slot(ring, pos);
+	ee_write(slot, src, ring->len);
+	ee_write(slot + ring->len, &trl, sizeof(struct ee_ring_trl));
+	ring->pos = pos;
+	ring->seq = trl.seq;
+	return 1;
+}
+
+// -------------------------------------------------------------------------------------------------
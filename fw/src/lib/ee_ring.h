@@ -0,0 +1,37 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------------------------------------
+// EEPROM ring log: fixed-size records are written to the consecutive slots of an EEPROM region,
+// each write goes to the slot after the newest record. Wear is spread over all slots.
+// 2-slot ring is an A/B record: a new record never overwrites the current one.
+// Slot layout: record data, layout version, 16-bit sequence number, CRC16 of the above.
+// Newest record is the one with the greatest sequence number, valid CRC and matching version.
+// Torn write leaves a bad CRC, so the previous record is loaded then.
+
+// Slot size for the record length.
+#define EE_RING_SLOT_SIZE(len)		((len) + 5)
+
+struct ee_ring {
+	uint8_t *base;			// EEPROM region, n * EE_RING_SLOT_SIZE(len) bytes
+	uint8_t len;			// record length
+	uint8_t n;				// number of slots
+	uint8_t ver;			// record layout version
+	uint8_t pos;			// slot of the newest record. internal use only.
+	uint16_t seq;			// sequence number of the newest record. internal use only.
+};
+
+#define EE_RING(base, len, n, ver)	{ (uint8_t*)(base), len, n, ver, (n) - 1, 0xFFFF }
+
+// Finds the newest valid record and reads it to dst.
+// Returns zero if no valid record found, dst is not modified then.
+uint8_t ee_ring_load(struct ee_ring *ring, void *dst);
+
+// Queues the record write to the next slot.
+// Returns zero if the write queue has no space, nothing is queued then.
+uint8_t ee_ring_save(struct ee_ring *ring, const void *src);
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "energy.h"
+
+// -------------------------------------------------------------------------------------------------
+
+#ifdef ENERGY_ACCT
+
+static const uint16_t energy_mode_ua[EN_MODE_N] PROGMEM = ENERGY_UA_MODE;
+static const uint16_t energy_per_ua[EN_N] PROGMEM = ENERGY_UA_PER;
+
+uint32_t energy_mode_time[EN_MODE_N];
+uint32_t energy_on_time[EN_N];
+
+static uint8_t en_mode;						// current mode
+static uint16_t en_mode_stamp;				// time of the last mode update
+static uint16_t en_mode_acc[EN_MODE_N];		// pending mode counts
+static uint8_t en_on;						// peripheral on bit map
+static uint16_t en_on_stamp;				// time of the last on-time update
+
+// Accounts the current mode until t, switches the mode.
+static void en_mode_set(uint16_t t, uint8_t mode)
+{
+	en_mode_acc[en_mode] += t - en_mode_stamp;
+	en_mode_stamp = t;
+	en_mode = mode;
+}
+
+// Accounts the peripheral on-time until t.
+static void en_on_upd(uint16_t t)
+{
+	uint8_t i, on = en_on;
+	uint16_t d = t - en_on_stamp;
+	en_on_stamp = t;
+	for(i = 0; on != 0; i++, on >>= 1) {
+		if(on & 1)
+			energy_on_time[i] += d;
+	}
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void energy_set(uint8_t per, uint8_t on)
+{
+	uint8_t m = 1 << per;
+	if(!on == !(en_on & m))
+		return;
+	en_on_upd(rtc_time());
+	en_on ^= m;
+}
+
+void energy_sleep_enter()
+{
+	uint8_t mode;
+	switch(SMCR & ((1<<SM2)|(1<<SM1)|(1<<SM0))) {
+	case 0:
+		mode = EN_MODE_IDLE;
+		break;
+	case (1<<SM0):
+		mode = EN_MODE_ADC;
+		break;
+	case (1<<SM1):
+	case (1<<SM1)|(1<<SM0):
+		mode = EN_MODE_PWR_SAVE;
+		break;
+	default:
+		mode = EN_MODE_STANDBY;
+		break;
+	}
+	en_mode_set(rtc_time(), mode);
+}
+
+void energy_sleep_exit()
+{
+	en_mode_set(rtc_time(), EN_MODE_ACTIVE);
+}
+
+void energy_tick()
+{
+	uint8_t i;
+	uint16_t t = rtc_time();
+	en_mode_set(t, en_mode);
+	for(i = 0; i < EN_MODE_N; i++) {
+		energy_mode_time[i] += en_mode_acc[i];
+		en_mode_acc[i] = 0;
+	}
+	en_on_upd(t);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+// Charge for the time t at the current ua, uAh.
+static uint32_t en_uah(uint32_t t, uint16_t ua)
+{
+	uint32_t s = t / ENERGY_FREQ;
+	return (s / 3600) * ua + (s % 3600) * ua / 3600;
+}
+
+uint32_t energy_uah()
+{
+	uint8_t i;
+	uint32_t uah = 0;
+	for(i = 0; i < EN_MODE_N; i++)
+		uah += en_uah(energy_mode_time[i], pgm_read_word(&energy_mode_ua[i]));
+	for(i = 0; i < EN_N; i++)
+		uah += en_uah(energy_on_time[i], pgm_read_word(&energy_per_ua[i]));
+	return uah;
+}
+
+uint16_t energy_avg_ua()
+{
+	uint8_t i, sh = 0;
+	uint32_t t = 0, ua = 0;
+	for(i = 0; i < EN_MODE_N; i++)
+		t += energy_mode_time[i];
+	// time weights under 16 bits, ua * weight fits 32 bits
+	while((t >> sh) > 0xFFFF)
+		sh++;
+	t >>= sh;
+	if(t == 0)
+		return 0;
+	for(i = 0; i < EN_MODE_N; i++)
+		ua += (uint32_t)pgm_read_word(&energy_mode_ua[i]) * (energy_mode_time[i] >> sh) / t;
+	for(i = 0; i < EN_N; i++)
+		ua += (uint32_t)pgm_read_word(&energy_per_ua[i]) * (energy_on_time[i] >> sh) / t;
+	return (ua < 0xFFFF) ? ua : 0xFFFF;
+}
+
+#endif // ENERGY_ACCT
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include "../config.h"
+#include "rtc.h"
+
+// -------------------------------------------------------------------------------------------------
+// Energy accounting: time spent in each sleep mode and peripheral on-time are integrated on the
+// RTC counter (Timer2, ENERGY_FREQ Hz), charge is estimated from the current table in config.h.
+// Periods shorter than a counter step are counted statistically, as the CPU and RTC clocks
+// are not synchronized.
+
+#define ENERGY_FREQ			RTC_TIME_FREQ
+
+// MCU modes
+enum {
+	EN_MODE_ACTIVE,
+	EN_MODE_IDLE,
+	EN_MODE_ADC,			// ADC noise reduction
+	EN_MODE_PWR_SAVE,		// power save, power down
+	EN_MODE_STANDBY,		// standby, extended standby
+	EN_MODE_N
+};
+
+// Peripherals
+enum {
+	EN_DISP,				// Timer0: display refresh
+	EN_BUZZ,				// buzzer output
+	EN_ADC,					// ADC refresh
+	EN_WORK,				// WORK output
+	EN_BYPASS,				// BYPASS output
+	EN_LAMP,				// LAMP output
+	EN_CLK_FAST,			// CPU at full speed (clk.h)
+	EN_N
+};
+
+#ifdef ENERGY_ACCT
+
+// Time in each mode and peripheral on-time, 1/ENERGY_FREQ s. Updated by energy_tick.
+extern uint32_t energy_mode_time[EN_MODE_N];
+extern uint32_t energy_on_time[EN_N];
+
+// Peripheral on/off. Peripheral is off at reset.
+void energy_set(uint8_t per, uint8_t on);
+
+// Sleep mode enter and exit (OS_SLEEP_ENTER, OS_SLEEP_EXIT).
+void energy_sleep_enter();
+void energy_sleep_exit();
+
+// Moves the pending counts to the time counters. Must be called at least every 256s.
+void energy_tick();
+
+// Returns the estimated charge since reset, uAh.
+uint32_t energy_uah();
+
+// Returns the estimated average current since reset, uA.
+uint16_t energy_avg_ua();
+
+#else // ENERGY_ACCT
+
+#define energy_set(per, on)
+
+#endif // ENERGY_ACCT
+
+// -------------------------------------------------------------------------------------------------
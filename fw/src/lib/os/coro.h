@@ -0,0 +1,95 @@
+// -------------------------------------------------------------------------------------------------
+// Coroutine
+
+#pragma once
+
+#include <stdint.h>
+#include "task.h"
+#include "tmr.h"
+#include "os_cfg.h"
+
+// -------------------------------------------------------------------------------------------------
+
+#if (defined OS_TMR) && (defined OS_TMR_ONESHOT)
+
+// Stackless coroutine: a function resumed at the last wait point by its one-shot timer task.
+// Local variables are not preserved over the waits, keep the state in a wrapping structure.
+// Wait macros return from the function, so they can't be used in a nested function or switch.
+//
+// static void blink(struct coro *co)
+// {
+//     CORO_BEGIN(co);
+//     for(;;) {
+//         LED_ON();
+//         CORO_SLEEP_TICKS(co, T_MS(96));
+//         LED_OFF();
+//         CORO_WAIT_UNTIL(co, blink_enabled);
+//     }
+//     CORO_END(co);
+// }
+// static struct coro blink_co = CORO(blink);
+
+// Coroutine function.
+struct coro;
+typedef void (*coro_func_t)(struct coro *co);
+
+// Coroutine handle.
+struct coro {
+	struct tmr_oneshot tmr;			// resume timer, tmr.task resumes the coroutine.
+	uint16_t lc;					// resume point, 0 at start. internal use only.
+};
+
+// Coroutine handle static initialization.
+#define CORO(func)					{ TMR_ONESHOT(func), 0 }
+
+// Starts the coroutine from the beginning.
+// Note: Never call for a running coroutine, stop it first.
+#define coro_start(co)				((co)->lc = 0, coro_wake(co))
+
+// Stops the coroutine, cancels the pending resume.
+// Note: Flag bound by CORO_WAIT_FLAG is not unbound.
+#define coro_stop(co)				((co)->lc = 0, tmr_oneshot_cancel(&((co)->tmr)))
+
+// Resumes the waiting coroutine with normal priority.
+// Returns zero if resume already pending.
+#define coro_wake(co)				task_schedule(&((co)->tmr.task), TASK_PRIORITY_NORMAL)
+
+// Coroutine body start and end. Coroutine restarts from the beginning after the end.
+#define CORO_BEGIN(co)				switch((co)->lc) { case 0:
+#define CORO_END(co)				} (co)->lc = 0
+
+// Resumes the coroutine after the other pending tasks.
+#define CORO_YIELD(co) do {											\
+		(co)->lc = __LINE__; coro_wake(co); return; case __LINE__:;	\
+	} while(0)
+
+// Resumes the coroutine after n ticks or seconds (0..TMR_ELAPSE_MAX).
+// Resumes after the other pending tasks if the timer can't be set.
+#define CORO_SLEEP_TICKS(co, n)		_CORO_SLEEP(co, TMR_UNIT_TICK, n)
+#define CORO_SLEEP_SECONDS(co, n)	_CORO_SLEEP(co, TMR_UNIT_SECOND, n)
+#define _CORO_SLEEP(co, unit, n) do {								\
+		(co)->lc = __LINE__;										\
+		if(!tmr_oneshot_set(&((co)->tmr), unit, n))					\
+			coro_wake(co);											\
+		return; case __LINE__:;										\
+	} while(0)
+
+// Waits until the condition is true. Condition is checked on each coro_wake.
+#define CORO_WAIT_UNTIL(co, cond) do {								\
+		(co)->lc = __LINE__; case __LINE__:							\
+		if(!(cond)) return;											\
+	} while(0)
+
+// Waits for the task flag i, e.g. set by an interrupt. Flag is bound while waiting only.
+// Note: OS_TASK_FLAG_STATIC: coroutine must be global and bound to the flag in
+//       OS_TASK_FLAG_CORO_BINDINGS (os_cfg.h), the wait only enables the flag.
+#define CORO_WAIT_FLAG(co, i) do {									\
+		(co)->lc = __LINE__;										\
+		task_flag_bind(i, &((co)->tmr.task), TASK_PRIORITY_NORMAL);	\
+		return; case __LINE__:										\
+		task_flag_unbind(i);										\
+	} while(0)
+
+#endif // OS_TMR && OS_TMR_ONESHOT
+
+// -------------------------------------------------------------------------------------------------
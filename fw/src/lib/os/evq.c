@@ -0,0 +1,56 @@
+// -------------------------------------------------------------------------------------------------
+// Event queue
+
+#include "evq.h"
+
+#ifdef OS_EVQ
+
+// Keeps the entry access before the position update.
+#define evq_barrier()				__asm__ __volatile__ ("" ::: "memory")
+
+// -------------------------------------------------------------------------------------------------
+
+// Puts the event to the queue. Call from the producer only.
+// Returns zero if queue is full, event is dropped then.
+uint8_t evq_put(struct evq *q, uint8_t code, uint8_t arg, uint16_t stamp)
+{
+	uint8_t head = q->head;
+	struct evq_ent *ent;
+	if((uint8_t)(head - q->tail) > q->mask) {
+		if(q->lost != 0xFF)
+			q->lost++;
+		return 0;
+	}
+	// write the entry, then publish it
+	ent = &(q->ent[head & q->mask]);
+	ent->code = code;
+	ent->arg = arg;
+	ent->stamp = stamp;
+	evq_barrier();
+	q->head = head + 1;
+	return 1;
+}
+
+// Gets the oldest event from the queue. Call from the consumer only.
+// Returns zero if queue is empty.
+uint8_t evq_get(struct evq *q, struct evq_ent *ev)
+{
+	uint8_t tail = q->tail;
+	struct evq_ent *ent;
+	if(tail == q->head)
+		return 0;
+	// read the entry, then release it
+	ent = &(q->ent[tail & q->mask]);
+	ev->code = ent->code;
+	ev->arg = ent->arg;
+	ev->stamp = ent->stamp;
+	evq_barrier();
+	q->tail = tail + 1;
+	return 1;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+#endif // OS_EVQ
+
+// -------------------------------------------------------------------------------------------------
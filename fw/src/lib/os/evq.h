@@ -0,0 +1,67 @@
+// -------------------------------------------------------------------------------------------------
+// Event queue
+
+#pragma once
+
+#ifndef __ASSEMBLER__
+  #include <stdint.h>
+#endif // __ASSEMBLER__
+#include "os_cfg.h"
+
+// -------------------------------------------------------------------------------------------------
+
+#ifdef OS_EVQ
+
+// Single producer, single consumer event queue.
+// Producer is an interrupt handler (evq_put macro in evq.inc or evq_put function),
+// consumer is the task bound to the producer's task flag. No locking needed: the producer
+// writes only the head position, the consumer writes only the tail position.
+// Events put to the full queue are dropped and counted.
+
+// Queue layout, used by asm. do not change
+#define EVQ_HEAD					0
+#define EVQ_TAIL					1
+#define EVQ_MASK					2
+#define EVQ_LOST					3
+#define EVQ_ENT						4
+
+// Max queue length, entries. Queue length must be a power of 2.
+#define EVQ_LEN_MAX					32
+
+#ifndef __ASSEMBLER__
+
+// Event.
+struct evq_ent {
+	uint8_t code;					// event code
+	uint8_t arg;					// event argument
+	uint16_t stamp;					// event timestamp
+};
+
+// Event queue.
+struct evq {
+	volatile uint8_t head;			// put position. internal use only.
+	volatile uint8_t tail;			// get position. internal use only.
+	uint8_t mask;					// length - 1. internal use only.
+	volatile uint8_t lost;			// number of events dropped, saturating
+	struct evq_ent ent[];			// entries. internal use only.
+};
+
+// Event queue static initialization.
+#define EVQ(len)					{ 0, 0, (len) - 1, 0, { [(len) - 1] = { 0, 0, 0 } } }
+
+// Puts the event to the queue. Call from the producer only.
+// Returns zero if queue is full, event is dropped then.
+uint8_t evq_put(struct evq *q, uint8_t code, uint8_t arg, uint16_t stamp);
+
+// Gets the oldest event from the queue. Call from the consumer only.
+// Returns zero if queue is empty.
+uint8_t evq_get(struct evq *q, struct evq_ent *ev);
+
+// Returns the number of events in the queue.
+#define evq_count(q)				((uint8_t)((q)->head - (q)->tail))
+
+#endif // __ASSEMBLER__
+
+#endif // OS_EVQ
+
+// -------------------------------------------------------------------------------------------------
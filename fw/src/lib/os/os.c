@@ -14,6 +14,30 @@
 // Task and timer queue status bit map.
 uint8_t os_que_st;
 
+// -------------------------------------------------------------------------------------------------
+// Scheduler statistics.
+
+#ifdef OS_STATS
+
+struct os_stats os_stats;
+uint8_t os_flag_merged[OS_TASK_FLAG_COUNT];
+
+static uint16_t os_stats_stamp;		// time of the last sleep enter or exit
+
+// Clears the statistics.
+void os_stats_reset()
+{
+	uint8_t i;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(i = 0; i < sizeof(os_stats); i++)
+			((uint8_t*)&os_stats)[i] = 0;
+		for(i = 0; i < OS_TASK_FLAG_COUNT; i++)
+			os_flag_merged[i] = 0;
+	}
+}
+
+#endif // OS_STATS
+
 // -------------------------------------------------------------------------------------------------
 // Stack checking.
 
@@ -74,7 +98,7 @@ uint16_t volatile t_tick_src;
 
 // Tick update task.
 static void tick_upd(struct task_handle *_task);
-static struct task_handle tick_upd_task = TASK_HANDLE(tick_upd);
+struct task_handle tick_upd_task = TASK_HANDLE(tick_upd);
 
 // Tick counter.
 uint16_t t_tick;
@@ -183,6 +207,58 @@ uint16_t t_tick_read()
 }
 #endif // OS_TICK_READ
 
+// -------------------------------------------------------------------------------------------------
+// Tickless idle.
+
+#ifdef OS_TICKLESS
+
+// Returns the number of ticks until the next tick or second timer deadline.
+// Called with interrupts disabled, when no task flags are set.
+static uint16_t tick_idle()
+{
+	uint16_t n = OS_TICKLESS_MAX;
+#ifdef OS_TMR
+	uint8_t qs = os_que_st;
+	uint16_t d;
+  #ifdef OS_TMR_TICK
+	// tick timers
+	#ifdef OS_TMR_ONESHOT
+	if(qs & OS_QUE_ST_TMR_ONS_TICK) {
+		d = tmr_ons_next(&tmr_ons_tick, t_tick);
+		if(d < n) n = d;
+	}
+	#endif // OS_TMR_ONESHOT
+	#ifdef OS_TMR_INTERVAL
+	if(qs & OS_QUE_ST_TMR_INT_TICK) {
+		d = tmr_int_next(&tmr_int_tick, t_tick);
+		if(d < n) n = d;
+	}
+	#endif // OS_TMR_INTERVAL
+  #endif // OS_TMR_TICK
+  #if (defined OS_TMR_SECOND) && (defined OS_TICK_SEC_DIV_INT)
+	// second timers, rounded down to the whole ticks
+	d = OS_TICKLESS_MAX / OS_TICK_SEC_DIV_INT + 1;
+	#ifdef OS_TMR_ONESHOT
+	if(qs & OS_QUE_ST_TMR_ONS_SEC) {
+		uint16_t s = tmr_ons_next(&tmr_ons_sec, t_sec);
+		if(s < d) d = s;
+	}
+	#endif // OS_TMR_ONESHOT
+	#ifdef OS_TMR_INTERVAL
+	if(qs & OS_QUE_ST_TMR_INT_SEC) {
+		uint16_t s = tmr_int_next(&tmr_int_sec, t_sec);
+		if(s < d) d = s;
+	}
+	#endif // OS_TMR_INTERVAL
+	d = (d != 0) ? (d * OS_TICK_SEC_DIV_INT - (t_tick - t_sec_prev)) : 0;
+	if(d < n) n = d;
+  #endif // OS_TMR_SECOND
+#endif // OS_TMR
+	return n;
+}
+
+#endif // OS_TICKLESS
+
 #ifdef OS_TICK_WAIT
 void t_tick_wait(uint16_t n)
 {
@@ -279,6 +355,46 @@ void os_init()
 	sleep_enable();
 }
 
+// Enters the sleep mode. Called with interrupts disabled, returns with interrupts enabled.
+// n is the number of ticks until the next timer deadline, zero if the tick source runs.
+static void os_sleep(uint16_t n)
+{
+#ifdef OS_STATS
+	uint16_t t;
+#endif // OS_STATS
+#ifdef OS_WD_TIMEOUT
+	wdt_reset();
+#endif // OS_WD_TIMEOUT
+#ifdef OS_SLEEP_GOV
+	set_sleep_mode(OS_SLEEP_MODE(n));
+#endif // OS_SLEEP_GOV
+#ifdef OS_BOD_DISABLE
+	if(SMCR & (1<<SM1)) {
+		MCUCR = (1<<BODS)|(1<<BODSE);
+		MCUCR = 1<<BODS;
+	}
+#endif // OS_BOD_DISABLE
+#ifdef OS_STATS
+	t = OS_STATS_TIME_READ();
+	os_stats.awake += (uint16_t)(t - os_stats_stamp);
+	os_stats_stamp = t;
+#endif // OS_STATS
+#ifdef OS_SLEEP_ENTER
+	OS_SLEEP_ENTER();
+#endif // OS_SLEEP_ENTER
+	sei();
+	sleep_cpu();
+#ifdef OS_SLEEP_EXIT
+	OS_SLEEP_EXIT();
+#endif // OS_SLEEP_EXIT
+#ifdef OS_STATS
+	os_stats.wakeups++;
+	t = OS_STATS_TIME_READ();
+	os_stats.asleep += (uint16_t)(t - os_stats_stamp);
+	os_stats_stamp = t;
+#endif // OS_STATS
+}
+
 void __builtin_unreachable(void);
 
 __attribute__((noreturn))
@@ -318,18 +434,29 @@ void os_run()
 		// Disable interrupt and ensure no task flags are set.
 		cli();
 		if(!task_flag_check()) {
+#ifdef OS_TICKLESS
+			// Stop the tick source if no tick timers are triggered soon.
+			// Sleep until a task flag is set, then restart the tick source.
+			uint16_t n;
+			if( OS_TICKLESS_ALLOWED() &&
+				((n = tick_idle()) >= OS_TICKLESS_MIN) &&
+				OS_TICKLESS_START(n) )
+			{
+				do {
+					os_sleep(n);
+					cli();
+				} while(!task_flag_check());
+				n = OS_TICKLESS_STOP();
+				t_tick_src += n;
+#ifdef OS_STATS
+				os_stats.sleep_ticks += n;
+#endif // OS_STATS
+				TASK_FLAG_SET(OS_TICK_UPD_FLAG);
+				sei();
+			} else
+#endif // OS_TICKLESS
 			// Wait for an interrupt.
-#ifdef OS_WD_TIMEOUT
-			wdt_reset();
-#endif // OS_WD_TIMEOUT
-#ifdef OS_BOD_DISABLE
-			if(SMCR & (1<<SM1)) {
-				MCUCR = (1<<BODS)|(1<<BODSE);
-				MCUCR = 1<<BODS;
-			}
-#endif // OS_BOD_DISABLE
-			sei();
-			sleep_cpu();
+			os_sleep(0);
 		} else {
 			// Have task flag(s) set, return to the task loop.
 			sei();
@@ -6,6 +6,8 @@
 #include "task.h"
 #include "task_flg.h"
 #include "tmr.h"
+#include "evq.h"
+#include "coro.h"
 #include "os_cfg.h"
 
 // -------------------------------------------------------------------------------------------------
@@ -47,6 +49,35 @@ uint16_t t_tick_read();
 void t_tick_wait(uint16_t n);
 #endif // OS_TICK_WAIT
 
+// -------------------------------------------------------------------------------------------------
+// Scheduler statistics.
+
+#ifdef OS_STATS
+
+struct os_stats {
+	uint32_t wakeups;				// wakeups from sleep
+#ifdef OS_TICKLESS
+	uint32_t sleep_ticks;			// ticks slept with the tick source stopped
+#endif // OS_TICKLESS
+	uint32_t asleep;				// time asleep, 1/OS_STATS_TIME_FREQ s
+	uint32_t awake;					// time awake, 1/OS_STATS_TIME_FREQ s
+	uint16_t tmr_slips;				// interval timer triggers slipped to the current time
+	uint16_t tmr_late_tick;			// max interval timer lateness, ticks
+	uint16_t tmr_late_sec;			// max interval timer lateness, seconds
+};
+
+extern struct os_stats os_stats;
+
+// Number of task flag events merged with the pending ones, per flag, saturating.
+// Counted when the flag is set again before the flag task was scheduled (by interrupt) or
+// when the flag task is still pending (by scheduler).
+extern uint8_t os_flag_merged[OS_TASK_FLAG_COUNT];
+
+// Clears the statistics.
+void os_stats_reset();
+
+#endif // OS_STATS
+
 // -------------------------------------------------------------------------------------------------
 
 void os_init();
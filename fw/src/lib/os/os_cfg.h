@@ -2,8 +2,11 @@
 
 #pragma once
 
-#include <stdint.h>
+#ifndef __ASSEMBLER__
+  #include <stdint.h>
+#endif // __ASSEMBLER__
 #include "../../hwconf.h"
+#include "../../config.h"
 
 // -------------------------------------------------------------------------------------------------
 // OS options.
@@ -29,6 +32,31 @@
 // Comment to disable.
 #define OS_BOD_DISABLE
 
+// -------------------------------------------------------------------------------------------------
+// Sleep mode configuration.
+
+// Sleep mode governor, selects the sleep mode for each idle period.
+// OS_SLEEP_MODE(n): returns the sleep mode, n is the number of ticks until the next timer deadline
+//   (OS_TICKLESS_MAX if no deadline soon), zero if the tick source runs.
+//   Called with interrupts disabled.
+// Comment to use the sleep mode set by set_sleep_mode.
+#define OS_SLEEP_GOV
+#ifndef __ASSEMBLER__
+  #include "../sleep_gov.h"
+#endif // __ASSEMBLER__
+#define OS_SLEEP_MODE(n)			sleep_gov_mode(n)
+
+// Sleep hooks, e.g. for the energy accounting. Comment to disable.
+// OS_SLEEP_ENTER(): called before the sleep with interrupts disabled, sleep mode is set.
+// OS_SLEEP_EXIT(): called after the wakeup with interrupts enabled.
+#ifdef ENERGY_ACCT
+  #ifndef __ASSEMBLER__
+    #include "../energy.h"
+  #endif // __ASSEMBLER__
+  #define OS_SLEEP_ENTER()			energy_sleep_enter()
+  #define OS_SLEEP_EXIT()			energy_sleep_exit()
+#endif // ENERGY_ACCT
+
 // -------------------------------------------------------------------------------------------------
 // Stack checking configuration.
 
@@ -50,7 +78,7 @@
 // System tick frequency as floating-point constant. Must be same as OS_TICK_SEC_DIV.
 // Comment to disable T_US and T_MS macros.
 //#define OS_TICK_FREQ				(F_CPU / 16384.0)
-#define OS_TICK_FREQ				(F_CPU / 19200.0) // 4.8ms @ 4MHz
+#define OS_TICK_FREQ				(32768 / 256.0) // 7.8ms, Timer2 count
 
 // System tick frequency as natural fraction. Must be same as OS_TICK_FREQ.
 // Comment to disable the second counter.
@@ -73,14 +101,39 @@
 ////#define OS_TICK_SEC_DIV_P		1		// frac part numerator
 ////#define OS_TICK_SEC_DIV_Q		1		// frac part denominator
 //#endif // F_CPU
-#define OS_TICK_SEC_DIV_INT			208		// int part
-#define OS_TICK_SEC_DIV_P			1		// frac part numerator
-#define OS_TICK_SEC_DIV_Q			3		// frac part denominator
+#define OS_TICK_SEC_DIV_INT			128		// int part
+//#define OS_TICK_SEC_DIV_P			1		// frac part numerator
+//#define OS_TICK_SEC_DIV_Q			1		// frac part denominator
 
 // Tick function configuration. Comment to disable.
 #define OS_TICK_READ		// implement the t_tick_read function
 #define OS_TICK_WAIT		// implement the t_tick_wait function
 
+// -------------------------------------------------------------------------------------------------
+// Tickless idle configuration.
+
+// Stop the tick source while sleeping until the next tick or second timer deadline.
+// Sleep is limited by the earliest timer: while powered, the ADC refresh (ADC_REFRESH_MS) cuts
+// it to ~6 ticks. Long sleeps are reached after power off only. Comment to disable.
+#define OS_TICKLESS
+
+// Min and max number of idle ticks to stop the tick source for.
+#define OS_TICKLESS_MIN				3
+#define OS_TICKLESS_MAX				250
+
+// Tick source control. Called with interrupts disabled.
+// OS_TICKLESS_ALLOWED(): returns nonzero if the tick source can be stopped.
+// OS_TICKLESS_START(n): stops the tick source and sets up a wakeup in n ticks or earlier.
+//   Returns zero if tick source can't be stopped.
+//   Wakeup interrupt must set a task flag, e.g. OS_TICK_UPD_FLAG.
+// OS_TICKLESS_STOP(): restarts the tick source. Returns the number of ticks elapsed.
+#ifndef __ASSEMBLER__
+  #include "../tickless.h"
+#endif // __ASSEMBLER__
+#define OS_TICKLESS_ALLOWED()		tickless_allowed()
+#define OS_TICKLESS_START(n)		tickless_start(n)
+#define OS_TICKLESS_STOP()			tickless_stop()
+
 // -------------------------------------------------------------------------------------------------
 // Task configuration.
 
@@ -94,9 +147,54 @@
   #define OS_TASK_REG_2				GPIOR2
 #endif // GPIOR0
 
+// Static task flag bindings. Comment to bind the flag tasks at run time.
+// Flag tasks are listed in OS_TASK_FLAG_BINDINGS (see Task Flags), the flag dispatch code and
+// the flag task table (PROGMEM) are generated at compile time.
+// task_flag_bind and task_flag_unbind only enable and disable the flag then.
+#define OS_TASK_FLAG_STATIC
+
 // Max number of dynamic tasks. Comment to disable dynamic task allocation.
 #define OS_TASK_DYN_COUNT			8
 
+// -------------------------------------------------------------------------------------------------
+// Task profiling configuration.
+
+// Measure the run time of each task function. Comment to disable.
+// Time includes the interrupts served while the task runs.
+//#define OS_TASK_PROF
+
+// Number of profiling records. Tasks not fitting the table are counted in the last record.
+#define OS_TASK_PROF_COUNT			12
+
+// Histogram: bucket 0 counts run times below 2^OS_TASK_PROF_HIST_SHIFT counter units,
+// each next bucket doubles the limit, the last bucket counts all longer runs.
+#define OS_TASK_PROF_HIST_N			8
+#define OS_TASK_PROF_HIST_SHIFT		5
+
+// Free-running 16-bit counter, OS_TASK_PROF_DIV CPU cycles per unit.
+// Task run time must be under 65536 units.
+#define OS_TASK_PROF_DIV			PROF_CNT_DIV
+#define OS_TASK_PROF_INIT()			PROF_CNT_INIT()
+#define OS_TASK_PROF_READ()			PROF_CNT_READ()
+
+// -------------------------------------------------------------------------------------------------
+// Scheduler statistics configuration.
+
+// Count wakeups, sleep and awake time, merged task flags and interval timer slips, see os_stats.
+// Comment to disable.
+//#define OS_STATS
+
+// Free-running 16-bit counter for the sleep and awake time, must run in all sleep modes.
+// Periods shorter than a counter step are counted statistically.
+#define OS_STATS_TIME_FREQ			RTC_TIME_FREQ
+#define OS_STATS_TIME_READ()		rtc_time()
+
+// -------------------------------------------------------------------------------------------------
+// Event queue
+
+// Interrupt to task event queue with payloads (evq.h). Comment to disable.
+//#define OS_EVQ
+
 // -------------------------------------------------------------------------------------------------
 // Timer
 
@@ -107,6 +205,28 @@
 #define OS_TMR_ONESHOT		// One-shot timer
 #define OS_TMR_INTERVAL		// Interval timer
 
+// Timer queue backend. Comment to use the sorted list queues.
+// Hierarchical timing wheel: O(1) set, restart and cancel at the cost of RAM.
+// Each timer queue takes 2 * 2^OS_TMR_WHEEL_BITS * ceil(16 / OS_TMR_WHEEL_BITS) + 5 bytes
+// (133 bytes for 4 bits). The 7-byte wheel link grows each tmr_oneshot by 5 bytes (replaces
+// stamp_trig) and each tmr_interval by 3 bytes (replaces next and stamp_trig).
+//#define OS_TMR_WHEEL
+#define OS_TMR_WHEEL_BITS			4	// slot index bits per wheel level, 1..8
+
+// Timer slack: timer may trigger up to tmr->slack units late to share the wakeup with the other
+// timers. Tickless idle sleeps until the earliest trigger + slack. Sorted list queues only.
+// Each timer handle grows by 1 byte. Comment to disable.
+#define OS_TMR_SLACK
+
+// RTC timer: one-shot timers on a 32-bit second counter kept by the application, for deadlines
+// beyond TMR_ELAPSE_MAX. tmr_rtc_sched must be called after each counter update.
+// Comment to disable.
+#define OS_TMR_RTC
+#ifndef __ASSEMBLER__
+  #include "../rtc.h"
+#endif // __ASSEMBLER__
+#define OS_TMR_RTC_READ()			t_rtc_sec
+
 // -------------------------------------------------------------------------------------------------
 // Task Flags
 
@@ -124,9 +244,40 @@
 #define ADC_BUF_DONE_FLAG_ID		2
 #define ADC_BUF_DONE_FLAG			TASK_FLAG_2
 
+// used by asm. do not change
+#define DI_CHANGE_FLAG_ID			3
+#define DI_CHANGE_FLAG				TASK_FLAG_3
+
+// used by asm. do not change
+#define BTN_EDGE_FLAG_ID			4
+#define BTN_EDGE_FLAG				TASK_FLAG_4
+
+// used by asm. do not change
+#define EE_DONE_FLAG_ID				5
+#define EE_DONE_FLAG				TASK_FLAG_5
+
+// Static flag task bindings: BIND(flag id, global task handle, priority).
+#ifdef RO_EVENT_DRIVEN
+  #define OS_TASK_FLAG_BIND_DI(BIND)	BIND(DI_CHANGE_FLAG_ID, ro_update_task, TASK_PRIORITY_NORMAL)
+#else // RO_EVENT_DRIVEN
+  #define OS_TASK_FLAG_BIND_DI(BIND)
+#endif // RO_EVENT_DRIVEN
+#define OS_TASK_FLAG_BINDINGS(BIND)												\
+	BIND(OS_TICK_UPD_FLAG_ID,	tick_upd_task,		TASK_PRIORITY_NORMAL)		\
+	BIND(RTC_TICK_FLAG_ID,		rtc_tick_task,		TASK_PRIORITY_NORMAL)		\
+	BIND(ADC_BUF_DONE_FLAG_ID,	adc_buf_done_task,	TASK_PRIORITY_NORMAL)		\
+	OS_TASK_FLAG_BIND_DI(BIND)													\
+	BIND(BTN_EDGE_FLAG_ID,		btn_edge_task,		TASK_PRIORITY_NORMAL)		\
+	BIND(EE_DONE_FLAG_ID,		ee_done_task,		TASK_PRIORITY_NORMAL)
+
+// Static flag coroutine bindings for CORO_WAIT_FLAG: BIND(flag id, global coroutine, priority).
+#define OS_TASK_FLAG_CORO_BINDINGS(BIND)
+
 // -------------------------------------------------------------------------------------------------
 
+#ifndef __ASSEMBLER__
 void os_init();
 void os_run();
+#endif // __ASSEMBLER__
 
 // -------------------------------------------------------------------------------------------------
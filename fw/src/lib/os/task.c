@@ -1,7 +1,15 @@
 // -------------------------------------------------------------------------------------------------
 
 #include <stddef.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
 #include "task.h"
+#ifdef OS_TASK_FLAG_STATIC
+  #include "coro.h"
+#endif // OS_TASK_FLAG_STATIC
+#ifdef OS_STATS
+  #include "os.h"
+#endif // OS_STATS
 
 // -------------------------------------------------------------------------------------------------
 // Global task data.
@@ -32,8 +40,24 @@ static struct task_handle *task_next[TASK_QUEUE_COUNT];
 static struct task_handle **p_task_new[TASK_QUEUE_COUNT];
 
 // Flag-triggered task table.
+#ifndef OS_TASK_FLAG_STATIC
 static struct task_handle *task_flag_table[OS_TASK_FLAG_COUNT];
 static uint8_t task_flag_priority[(OS_TASK_FLAG_COUNT + 7) / 8];
+#define task_flag_task(i)			(task_flag_table[i])
+#else // OS_TASK_FLAG_STATIC
+#define TASK_FLAG_EXTERN(i, task, priority)		extern struct task_handle task;
+#define TASK_FLAG_ENTRY(i, task, priority)		[i] = &(task),
+#define TASK_FLAG_CORO_EXTERN(i, co, priority)	extern struct coro co;
+#define TASK_FLAG_CORO_ENTRY(i, co, priority)	TASK_FLAG_ENTRY(i, co.tmr.task, priority)
+OS_TASK_FLAG_BINDINGS(TASK_FLAG_EXTERN)
+OS_TASK_FLAG_CORO_BINDINGS(TASK_FLAG_CORO_EXTERN)
+static struct task_handle * const task_flag_table[OS_TASK_FLAG_COUNT] PROGMEM = {
+	OS_TASK_FLAG_BINDINGS(TASK_FLAG_ENTRY)
+	OS_TASK_FLAG_CORO_BINDINGS(TASK_FLAG_CORO_ENTRY)
+};
+static uint8_t task_flag_enabled[(OS_TASK_FLAG_COUNT + 7) / 8];
+#define task_flag_task(i)			((struct task_handle*) pgm_read_word(&(task_flag_table[i])))
+#endif // OS_TASK_FLAG_STATIC
 
 // Dynamic task handle pool.
 #ifdef OS_TASK_DYN_COUNT
@@ -45,6 +69,12 @@ static struct dyn_task_handle dyn_task_pool[OS_TASK_DYN_COUNT];
 static struct dyn_task_handle *dyn_task_freelist;
 #endif // OS_TASK_DYN_COUNT
 
+// Task profiling records.
+#ifdef OS_TASK_PROF
+static struct task_prof task_prof_table[OS_TASK_PROF_COUNT];
+static uint8_t task_prof_used;
+#endif // OS_TASK_PROF
+
 // -------------------------------------------------------------------------------------------------
 // Task
 
@@ -54,6 +84,7 @@ static struct dyn_task_handle *dyn_task_freelist;
 void task_init(struct task_handle *task, task_func_t func)
 {
 	task->next = (void*)-1;
+	task->p_prev = NULL;
 	task->func = func;
 }
 
@@ -72,7 +103,8 @@ uint8_t task_schedule(struct task_handle *task, uint8_t priority)
 	if(task_pending(task))
 		return 0;
 	// append task to the queue
-	task->next = *(p_task_new[priority]);
+	task->next = NULL;
+	task->p_prev = p_task_new[priority];
 	*(p_task_new[priority]) = task;
 	p_task_new[priority] = &(task->next);
 	os_que_st |= 1<<priority;
@@ -81,43 +113,77 @@ uint8_t task_schedule(struct task_handle *task, uint8_t priority)
 
 // Cancels a pending task.
 // Returns zero if task not found.
-// Note: This function is safe to call even if the task handle is not initialized.
+// Note: Task handle must be initialized or zero-filled.
 uint8_t task_cancel(struct task_handle *task)
 {
 	uint8_t pr;
-	struct task_handle **p_ent, *ent;
 #ifdef OS_PARAM_CHECK
 	if(task == NULL)
 		return 0;
 #endif // OS_PARAM_CHECK
-	// cancel the pending task
-	if(!task_pending(task))
+	// fail if task not queued
+	// (one-shot timer queue reuses the next link, p_prev is the task queue link only)
+	if(task->p_prev == NULL)
 		return 0;
-	// traverse task queues to find the task
-	for(pr = 0; pr < TASK_QUEUE_COUNT; pr++) {
-		p_ent = &(task_next[pr]);
-		ent = *p_ent;
-		while(ent != NULL) {
-			if(ent == task)
+	// unlink task from the queue
+	*(task->p_prev) = task->next;
+	if(task->next != NULL) {
+		task->next->p_prev = task->p_prev;
+	} else {
+		// last task: find the queue by its tail link
+		for(pr = 0; pr < TASK_QUEUE_COUNT - 1; pr++) {
+			if(p_task_new[pr] == &(task->next))
 				break;
-			p_ent = &(ent->next);
-			ent = *p_ent;
 		}
-		if(ent != NULL)
-			break;
+		p_task_new[pr] = task->p_prev;
+		if(task_next[pr] == NULL)
+			os_que_st &= ~(1<<pr);
 	}
-	if(ent == NULL)
-		return 0;
-	// remove task from the queue
-	if(task->next == NULL)
-		p_task_new[pr] = p_ent;
-	*p_ent = task->next;
 	task->next = (void*)-1;
-	if(task_next[pr] == NULL)
-		os_que_st &= ~(1<<pr);
+	task->p_prev = NULL;
 	return 1;
 }
 
+#ifdef OS_TASK_PROF
+// Adds the task run time to the profiling record.
+static void task_prof_add(task_func_t func, uint16_t t)
+{
+	struct task_prof *rec;
+	uint8_t i;
+	uint16_t lim;
+	// find or add the task function record
+	for(i = 0; i < task_prof_used; i++) {
+		if(task_prof_table[i].func == func)
+			break;
+	}
+	if(i == task_prof_used) {
+		if(i < OS_TASK_PROF_COUNT - 1) {
+			task_prof_table[i].func = func;
+			task_prof_used++;
+		} else {
+			i = OS_TASK_PROF_COUNT - 1;
+			task_prof_used = OS_TASK_PROF_COUNT;
+		}
+	}
+	rec = &(task_prof_table[i]);
+	// update counters, saturating
+	if(rec->calls != 0xFFFF)
+		rec->calls++;
+	rec->total += t;
+	if(t > rec->max)
+		rec->max = t;
+	// log2 histogram bucket
+	lim = 1 << OS_TASK_PROF_HIST_SHIFT;
+	for(i = 0; i < OS_TASK_PROF_HIST_N - 1; i++) {
+		if(t < lim)
+			break;
+		lim <<= 1;
+	}
+	if(rec->hist[i] != 0xFFFF)
+		rec->hist[i]++;
+}
+#endif // OS_TASK_PROF
+
 // Executes the next scheduled task with the highest priority.
 // Returns zero if all task queues are empty.
 uint8_t task_run_next()
@@ -125,12 +191,18 @@ uint8_t task_run_next()
 	// fetch next task from the queue
 	// don't use loop for the faster code
 	struct task_handle *task;
+#ifdef OS_TASK_PROF
+	task_func_t prof_func;
+	uint16_t prof_start;
+#endif // OS_TASK_PROF
 	if(os_que_st & (1<<TASK_PRIORITY_HIGH)) {
 		task = task_next[TASK_PRIORITY_HIGH];
 		task_next[TASK_PRIORITY_HIGH] = task->next;
 		if(task_next[TASK_PRIORITY_HIGH] == NULL) {
 			p_task_new[TASK_PRIORITY_HIGH] = &(task_next[TASK_PRIORITY_HIGH]);
 			os_que_st &= ~(1<<TASK_PRIORITY_HIGH);
+		} else {
+			task_next[TASK_PRIORITY_HIGH]->p_prev = &(task_next[TASK_PRIORITY_HIGH]);
 		}
 	} else if(os_que_st & (1<<TASK_PRIORITY_NORMAL)) {
 		task = task_next[TASK_PRIORITY_NORMAL];
@@ -138,6 +210,8 @@ uint8_t task_run_next()
 		if(task_next[TASK_PRIORITY_NORMAL] == NULL) {
 			p_task_new[TASK_PRIORITY_NORMAL] = &(task_next[TASK_PRIORITY_NORMAL]);
 			os_que_st &= ~(1<<TASK_PRIORITY_NORMAL);
+		} else {
+			task_next[TASK_PRIORITY_NORMAL]->p_prev = &(task_next[TASK_PRIORITY_NORMAL]);
 		}
 	} else if(os_que_st & (1<<TASK_PRIORITY_LOW)) {
 		task = task_next[TASK_PRIORITY_LOW];
@@ -145,11 +219,19 @@ uint8_t task_run_next()
 		if(task_next[TASK_PRIORITY_LOW] == NULL) {
 			p_task_new[TASK_PRIORITY_LOW] = &(task_next[TASK_PRIORITY_LOW]);
 			os_que_st &= ~(1<<TASK_PRIORITY_LOW);
+		} else {
+			task_next[TASK_PRIORITY_LOW]->p_prev = &(task_next[TASK_PRIORITY_LOW]);
 		}
 	} else {
 		return 0;
 	}
 	task->next = (void*)-1;
+	task->p_prev = NULL;
+#ifdef OS_TASK_PROF
+	// the handle may be reused by the task function
+	prof_func = task->func;
+	prof_start = OS_TASK_PROF_READ();
+#endif // OS_TASK_PROF
 	// call the task function
 #ifdef OS_TASK_DYN_COUNT
 	if( (task >= (struct task_handle*) dyn_task_pool) &&
@@ -166,12 +248,17 @@ uint8_t task_run_next()
 #ifdef OS_TASK_DYN_COUNT
 	}
 #endif // OS_TASK_DYN_COUNT
+#ifdef OS_TASK_PROF
+	task_prof_add(prof_func, OS_TASK_PROF_READ() - prof_start);
+#endif // OS_TASK_PROF
 	return 1;
 }
 
 // -------------------------------------------------------------------------------------------------
 // Flag-triggered task
 
+#ifndef OS_TASK_FLAG_STATIC
+
 // Binds initialized handle to the task trigger flag.
 // Returns zero if the specified flag already used.
 // Note: Never modify or dispose the passed task handle before unbinding it from the flag.
@@ -226,12 +313,76 @@ void task_sched_flags(uint8_t pos, uint8_t fl)
 		i += pos;
 		// schedule the task
 		if((i < OS_TASK_FLAG_COUNT) && (task_flag_table[i] != NULL)) {
+#ifdef OS_STATS
+			if( !task_schedule(task_flag_table[i],
+					(task_flag_priority[i >> 3] & m) ? TASK_PRIORITY_HIGH : TASK_PRIORITY_NORMAL) &&
+				(os_flag_merged[i] != 0xFF) )
+			{
+				os_flag_merged[i]++;
+			}
+#else // OS_STATS
 			task_schedule(task_flag_table[i],
 				(task_flag_priority[i >> 3] & m) ? TASK_PRIORITY_HIGH : TASK_PRIORITY_NORMAL);
+#endif // OS_STATS
 		}
 	}
 }
 
+#else // OS_TASK_FLAG_STATIC
+
+// Enables the statically bound task trigger flag.
+// Returns zero if flag already enabled or task is not bound to the flag.
+uint8_t task_flag_bind(uint8_t i, struct task_handle *task, uint8_t priority)
+{
+#ifdef OS_PARAM_CHECK
+	if((i >= OS_TASK_FLAG_COUNT) || (task == NULL) || (task != task_flag_task(i)))
+		return 0;
+#endif // OS_PARAM_CHECK
+	if(task_flag_enabled[i >> 3] & (1 << (i & 0x7)))
+		return 0;
+	task_flag_enabled[i >> 3] |= 1 << (i & 0x7);
+	return 1;
+}
+
+// Disables the statically bound task trigger flag, cancels the pending flag task.
+// Returns zero if flag not enabled.
+uint8_t task_flag_unbind(uint8_t i)
+{
+#ifdef OS_PARAM_CHECK
+	if(i >= OS_TASK_FLAG_COUNT)
+		return 0;
+#endif // OS_PARAM_CHECK
+	if(!(task_flag_enabled[i >> 3] & (1 << (i & 0x7))))
+		return 0;
+	task_flag_enabled[i >> 3] &= ~(1 << (i & 0x7));
+	task_cancel(task_flag_task(i));
+	return 1;
+}
+
+// Schedules the flag-triggered tasks.
+// Unrolled for the bound flags, pos is 0 for the most calls.
+#ifndef OS_STATS
+#define TASK_FLAG_SCHED(i, task, priority)							\
+	if((pos == ((i) & ~0x7)) && (fl & (1 << ((i) & 0x7))))			\
+		task_schedule(&(task), priority);
+#else // OS_STATS
+#define TASK_FLAG_SCHED(i, task, priority)							\
+	if( (pos == ((i) & ~0x7)) && (fl & (1 << ((i) & 0x7))) &&		\
+		!task_schedule(&(task), priority) && (os_flag_merged[i] != 0xFF) )	\
+	{																\
+		os_flag_merged[i]++;										\
+	}
+#endif // OS_STATS
+#define TASK_FLAG_CORO_SCHED(i, co, priority)	TASK_FLAG_SCHED(i, co.tmr.task, priority)
+void task_sched_flags(uint8_t pos, uint8_t fl)
+{
+	fl &= task_flag_enabled[pos >> 3];
+	OS_TASK_FLAG_BINDINGS(TASK_FLAG_SCHED)
+	OS_TASK_FLAG_CORO_BINDINGS(TASK_FLAG_CORO_SCHED)
+}
+
+#endif // OS_TASK_FLAG_STATIC
+
 // -------------------------------------------------------------------------------------------------
 // Dynamic task pool
 
@@ -272,7 +423,7 @@ uint8_t task_free(struct task_handle *task)
 	task_cancel((struct task_handle*)dyn_task);
 	// remove the flag-triggered task table entry
 	for(i = 0; i < OS_TASK_FLAG_COUNT; i++) {
-		if(task_flag_table[i] == (struct task_handle*)dyn_task)
+		if(task_flag_task(i) == (struct task_handle*)dyn_task)
 			task_flag_unbind(i);
 	}
 	// return dynamic entry to the freelist
@@ -283,6 +434,32 @@ uint8_t task_free(struct task_handle *task)
 
 #endif // OS_TASK_DYN_COUNT
 
+// -------------------------------------------------------------------------------------------------
+// Task profiling
+
+#ifdef OS_TASK_PROF
+
+// Returns the profiling record i.
+// Returns NULL if the record is not used.
+const struct task_prof * task_prof_get(uint8_t i)
+{
+	if(i >= task_prof_used)
+		return NULL;
+	return &(task_prof_table[i]);
+}
+
+// Clears the profiling records.
+void task_prof_reset()
+{
+	uint16_t i;
+	uint8_t *p = (uint8_t*) task_prof_table;
+	for(i = 0; i < sizeof(task_prof_table); i++)
+		p[i] = 0;
+	task_prof_used = 0;
+}
+
+#endif // OS_TASK_PROF
+
 // -------------------------------------------------------------------------------------------------
 // Init
 
@@ -297,6 +474,9 @@ void task_data_init()
 		dyn_task_pool[i].task.next = &(dyn_task_pool[i + 1].task);
 	dyn_task_freelist = &(dyn_task_pool[0]);
 #endif // OS_TASK_DYN_COUNT
+#ifdef OS_TASK_PROF
+	OS_TASK_PROF_INIT();
+#endif // OS_TASK_PROF
 }
 
 // -------------------------------------------------------------------------------------------------
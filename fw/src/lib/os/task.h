@@ -4,6 +4,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 #include "os_cfg.h"
 
 // -------------------------------------------------------------------------------------------------
@@ -23,11 +24,12 @@ typedef void (*task_func_t)(struct task_handle *task);
 // Note: Never modify or dispose handle of a pending task.
 struct task_handle {
 	struct task_handle *next;		// next item. internal use only.
+	struct task_handle **p_prev;	// link pointing to this task, NULL if not queued. internal use only.
 	task_func_t func;				// task function.
 };
 
 // Task handle static initialization.
-#define TASK_HANDLE(func)			{ (void*)-1, func }
+#define TASK_HANDLE(func)			{ (void*)-1, NULL, func }
 
 // Checks the initialized task handle state.
 // Returns nonzero if task pending.
@@ -46,7 +48,7 @@ uint8_t task_schedule(struct task_handle *task, uint8_t priority);
 
 // Cancels a pending task.
 // Returns zero if task not found.
-// Note: This function is safe to call even if the task handle is not initialized.
+// Note: Task handle must be initialized or zero-filled.
 uint8_t task_cancel(struct task_handle *task);
 
 // -------------------------------------------------------------------------------------------------
@@ -56,10 +58,13 @@ uint8_t task_cancel(struct task_handle *task);
 // Returns zero if the specified flag already used.
 // Note: Never modify or dispose the passed task handle before unbinding it from the flag.
 // Note: Flag-triggered task priority must be normal or high.
+// Note: OS_TASK_FLAG_STATIC: enables the flag, task must be the one bound in os_cfg.h,
+//       priority is taken from os_cfg.h.
 uint8_t task_flag_bind(uint8_t i, struct task_handle *task, uint8_t priority);
 
 // Unbinds task from the task trigger flag.
 // Returns zero if no task bound to the specified flag.
+// Note: OS_TASK_FLAG_STATIC: disables the flag.
 uint8_t task_flag_unbind(uint8_t i);
 
 // -------------------------------------------------------------------------------------------------
@@ -81,6 +86,30 @@ uint8_t task_free(struct task_handle *task);
 
 #endif // OS_TASK_DYN_COUNT
 
+// -------------------------------------------------------------------------------------------------
+// Task profiling
+
+#ifdef OS_TASK_PROF
+
+// Profiling record of a task function.
+// Times are in OS_TASK_PROF_DIV cycle units.
+struct task_prof {
+	task_func_t func;						// task function, NULL for the overflow record
+	uint16_t calls;							// number of calls
+	uint32_t total;							// total run time
+	uint16_t max;							// max run time
+	uint16_t hist[OS_TASK_PROF_HIST_N];		// run time histogram, see OS_TASK_PROF_HIST_SHIFT
+};
+
+// Returns the profiling record i.
+// Returns NULL if the record is not used.
+const struct task_prof * task_prof_get(uint8_t i);
+
+// Clears the profiling records.
+void task_prof_reset();
+
+#endif // OS_TASK_PROF
+
 // -------------------------------------------------------------------------------------------------
 // OS internal
 
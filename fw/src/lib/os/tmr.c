@@ -3,6 +3,9 @@
 
 #include <stddef.h>
 #include "tmr.h"
+#ifdef OS_STATS
+  #include "os.h"
+#endif // OS_STATS
 
 // -------------------------------------------------------------------------------------------------
 
@@ -27,10 +30,10 @@ extern uint8_t os_que_st;
 
 #ifdef OS_TMR_ONESHOT
   #ifdef OS_TMR_TICK
-    struct tmr_oneshot *tmr_ons_tick;
+    tmr_ons_que_t tmr_ons_tick;
   #endif // OS_TMR_TICK
   #ifdef OS_TMR_SECOND
-    struct tmr_oneshot *tmr_ons_sec;
+    tmr_ons_que_t tmr_ons_sec;
   #endif // OS_TMR_SECOND
   #if (defined OS_TMR_TICK) && (defined OS_TMR_SECOND)
     #define tmr_ons_istick(p_que)	((p_que) == &tmr_ons_tick)
@@ -39,14 +42,21 @@ extern uint8_t os_que_st;
   #else
     #define tmr_ons_istick(p_que)	0
   #endif
+  #if (defined OS_TMR_WHEEL) && (defined OS_TMR_TICK) && (defined OS_TMR_SECOND)
+    #define tmr_ons_unitque(unit)	(((unit) & TMR_UNIT_SECOND) ? &tmr_ons_sec : &tmr_ons_tick)
+  #elif (defined OS_TMR_WHEEL) && (defined OS_TMR_TICK)
+    #define tmr_ons_unitque(unit)	(&tmr_ons_tick)
+  #elif (defined OS_TMR_WHEEL)
+    #define tmr_ons_unitque(unit)	(&tmr_ons_sec)
+  #endif
 #endif // OS_TMR_ONESHOT
 
 #ifdef OS_TMR_INTERVAL
   #ifdef OS_TMR_TICK
-    struct tmr_interval *tmr_int_tick;
+    tmr_int_que_t tmr_int_tick;
   #endif // OS_TMR_TICK
   #ifdef OS_TMR_SECOND
-    struct tmr_interval *tmr_int_sec;
+    tmr_int_que_t tmr_int_sec;
   #endif // OS_TMR_SECOND
   #if (defined OS_TMR_TICK) && (defined OS_TMR_SECOND)
     #define tmr_int_istick(p_que)	((p_que) == &tmr_int_tick)
@@ -55,13 +65,145 @@ extern uint8_t os_que_st;
   #else
     #define tmr_int_istick(p_que)	0
   #endif
+  #if (defined OS_TMR_WHEEL) && (defined OS_TMR_TICK) && (defined OS_TMR_SECOND)
+    #define tmr_int_unitque(unit)	(((unit) & TMR_UNIT_SECOND) ? &tmr_int_sec : &tmr_int_tick)
+  #elif (defined OS_TMR_WHEEL) && (defined OS_TMR_TICK)
+    #define tmr_int_unitque(unit)	(&tmr_int_tick)
+  #elif (defined OS_TMR_WHEEL)
+    #define tmr_int_unitque(unit)	(&tmr_int_sec)
+  #endif
 #endif // OS_TMR_INTERVAL
 
+// -------------------------------------------------------------------------------------------------
+// Timing wheel
+
+#ifdef OS_TMR_WHEEL
+
+#define TMR_WHEEL_MASK				(TMR_WHEEL_SLOTS - 1)
+
+// Links timer to the list head.
+static void tmr_node_link(struct tmr_node **p_head, struct tmr_node *node)
+{
+	node->next = *p_head;
+	if(node->next != NULL)
+		node->next->p_prev = &(node->next);
+	node->p_prev = p_head;
+	*p_head = node;
+}
+
+// Unlinks timer from the list.
+static void tmr_node_unlink(struct tmr_node *node)
+{
+	*(node->p_prev) = node->next;
+	if(node->next != NULL)
+		node->next->p_prev = node->p_prev;
+	node->p_prev = NULL;
+}
+
+// Links timer to the wheel slot selected by the trigger timestamp.
+// (timer triggered at or before the wheel timestamp is linked to the due list)
+static void tmr_whl_place(struct tmr_wheel *whl, struct tmr_node *node)
+{
+	struct tmr_node **p_head;
+	uint16_t elap = node->stamp_trig - whl->stamp;
+	if((elap == 0) || (elap > TMR_ELAPSE_MAX)) {
+		p_head = &(whl->due);
+	} else {
+		// level n keeps timers triggering in 2^(n*bits)..2^((n+1)*bits)-1 units
+		uint8_t lvl = 0, sh = 0;
+		while((lvl < TMR_WHEEL_LEVELS - 1) && ((elap >> sh) > TMR_WHEEL_MASK)) {
+			lvl++;
+			sh += OS_TMR_WHEEL_BITS;
+		}
+		p_head = &(whl->slot[lvl][(node->stamp_trig >> sh) & TMR_WHEEL_MASK]);
+	}
+	tmr_node_link(p_head, node);
+}
+
+// Inserts timer to the wheel.
+static void tmr_whl_insert(struct tmr_wheel *whl, struct tmr_node *node,
+	uint16_t stamp_cur, uint8_t que_st)
+{
+	// empty wheel is not advanced, restart it from the current timestamp
+	if(whl->cnt++ == 0) {
+		whl->stamp = stamp_cur;
+		os_que_st |= que_st;
+	}
+	tmr_whl_place(whl, node);
+}
+
+// Removes timer from the wheel.
+static void tmr_whl_remove(struct tmr_wheel *whl, struct tmr_node *node, uint8_t que_st)
+{
+	tmr_node_unlink(node);
+	if(--(whl->cnt) == 0)
+		os_que_st &= ~que_st;
+}
+
+// Advances the wheel to the current timestamp.
+// Triggered timers are moved to the due list, upper levels are cascaded down on the way.
+static void tmr_whl_advance(struct tmr_wheel *whl, uint16_t stamp_cur)
+{
+	while(whl->stamp != stamp_cur) {
+		struct tmr_node *node, *next;
+		uint16_t stamp = ++(whl->stamp);
+		uint8_t lvl, sh;
+		// cascade the upper level slots when the lower level wraps
+		for(lvl = 1, sh = OS_TMR_WHEEL_BITS; lvl < TMR_WHEEL_LEVELS; lvl++, sh += OS_TMR_WHEEL_BITS) {
+			struct tmr_node **p_head;
+			if(stamp & ((1u << sh) - 1))
+				break;
+			p_head = &(whl->slot[lvl][(stamp >> sh) & TMR_WHEEL_MASK]);
+			node = *p_head;
+			*p_head = NULL;
+			for(; node != NULL; node = next) {
+				next = node->next;
+				tmr_whl_place(whl, node);
+			}
+		}
+		// move the triggered timers to the due list
+		node = whl->slot[0][stamp & TMR_WHEEL_MASK];
+		whl->slot[0][stamp & TMR_WHEEL_MASK] = NULL;
+		for(; node != NULL; node = next) {
+			next = node->next;
+			tmr_node_link(&(whl->due), node);
+		}
+	}
+}
+
+// Returns the number of time units until the next timer is triggered.
+// Upper level slots are accounted by their cascade timestamp, so result can be less than exact.
+static uint16_t tmr_whl_next(struct tmr_wheel *whl, uint16_t stamp_cur)
+{
+	uint16_t next = 0xffff, lag;
+	uint8_t lvl, sh, i;
+	if(whl->due != NULL)
+		return 0;
+	for(lvl = 0, sh = 0; lvl < TMR_WHEEL_LEVELS; lvl++, sh += OS_TMR_WHEEL_BITS) {
+		uint16_t base = whl->stamp >> sh;
+		for(i = 1; i <= TMR_WHEEL_SLOTS; i++) {
+			if(whl->slot[lvl][(base + i) & TMR_WHEEL_MASK] != NULL) {
+				uint16_t elap = ((uint16_t)(base + i) << sh) - whl->stamp;
+				if(elap < next)
+					next = elap;
+				break;
+			}
+		}
+	}
+	// wheel timestamp can lag behind the current timestamp
+	lag = stamp_cur - whl->stamp;
+	return (next > lag) ? (next - lag) : 0;
+}
+
+#endif // OS_TMR_WHEEL
+
 // -------------------------------------------------------------------------------------------------
 // One-shot timer
 
 #ifdef OS_TMR_ONESHOT
 
+#ifndef OS_TMR_WHEEL
+
 // Inserts one-shot timer to the queue.
 // (keeps queue sorted by the next trigger timestamp)
 static void tmr_ons_insert(struct tmr_oneshot **p_que,
@@ -125,13 +267,85 @@ void tmr_ons_sched(struct tmr_oneshot **p_que, uint16_t stamp_cur, uint8_t prior
 	}
 }
 
+// Returns the number of time units until the next one-shot timer is triggered.
+#ifndef OS_TMR_SLACK
+uint16_t tmr_ons_next(tmr_ons_que_t *p_que, uint16_t stamp_cur)
+{
+	uint16_t elap = (*p_que)->stamp_trig - stamp_cur;
+	return (elap <= TMR_ELAPSE_MAX) ? elap : 0;
+}
+#else // OS_TMR_SLACK
+uint16_t tmr_ons_next(tmr_ons_que_t *p_que, uint16_t stamp_cur)
+{
+	// earliest trigger + slack, queue is sorted by the trigger
+	struct tmr_oneshot *tmr;
+	uint16_t next = 0xffff;
+	for(tmr = *p_que; tmr != NULL; tmr = (struct tmr_oneshot*) tmr->task.next) {
+		uint16_t elap = tmr->stamp_trig - stamp_cur;
+		if(elap > TMR_ELAPSE_MAX)
+			elap = 0;
+		if(elap >= next)
+			break;
+		elap += tmr->slack;
+		if(elap < next)
+			next = elap;
+	}
+	return next;
+}
+#endif // OS_TMR_SLACK
+
+#else // OS_TMR_WHEEL
+
+#define tmr_ons_of(p_node) \
+	((struct tmr_oneshot*)((uint8_t*)(p_node) - offsetof(struct tmr_oneshot, node)))
+
+// Inserts one-shot timer to the wheel.
+static void tmr_ons_insert(tmr_ons_que_t *p_que,
+	struct tmr_oneshot *tmr, uint16_t stamp_cur, uint16_t elapse)
+{
+	tmr->node.stamp_trig = stamp_cur + elapse;
+	tmr->node.unit = tmr_ons_istick(p_que) ? TMR_UNIT_TICK : TMR_UNIT_SECOND;
+	tmr_whl_insert(p_que, &(tmr->node), stamp_cur,
+		tmr_ons_istick(p_que) ? OS_QUE_ST_TMR_ONS_TICK : OS_QUE_ST_TMR_ONS_SEC);
+}
+
+// Schedules tasks for the one-shot timer wheel until no more triggered timers.
+void tmr_ons_sched(tmr_ons_que_t *p_que, uint16_t stamp_cur, uint8_t priority)
+{
+	struct tmr_node *node, *next;
+	tmr_whl_advance(p_que, stamp_cur);
+	// schedule the triggered timer tasks
+	node = p_que->due;
+	p_que->due = NULL;
+	for(; node != NULL; node = next) {
+		next = node->next;
+		node->p_prev = NULL;
+		p_que->cnt--;
+		task_schedule(&(tmr_ons_of(node)->task), priority);
+	}
+	if(p_que->cnt == 0)
+		os_que_st &= tmr_ons_istick(p_que) ? ~OS_QUE_ST_TMR_ONS_TICK : ~OS_QUE_ST_TMR_ONS_SEC;
+}
+
+// Returns the number of time units until the next one-shot timer is triggered.
+uint16_t tmr_ons_next(tmr_ons_que_t *p_que, uint16_t stamp_cur)
+{
+	return tmr_whl_next(p_que, stamp_cur);
+}
+
+#endif // OS_TMR_WHEEL
+
 // Initializes an one-shot timer handle.
 // It is recommended to initialize timer handles once as a part of process initialization.
 // Note: Never call for a pending timer.
 void tmr_oneshot_init(struct tmr_oneshot *tmr, tmr_oneshot_func_t func)
 {
 	tmr->task.next = (void*)-1;
+	tmr->task.p_prev = NULL;
 	tmr->task.func = (task_func_t) func;
+#ifdef OS_TMR_WHEEL
+	tmr->node.p_prev = NULL;
+#endif // OS_TMR_WHEEL
 }
 
 // Starts or updates an initialized one-shot timer.
@@ -140,7 +354,7 @@ void tmr_oneshot_init(struct tmr_oneshot *tmr, tmr_oneshot_func_t func)
 //       and with low priority for a second-unit timer.
 uint8_t tmr_oneshot_set(struct tmr_oneshot *tmr, uint8_t flags, uint16_t elapse)
 {
-	struct tmr_oneshot **p_que;
+	tmr_ons_que_t *p_que;
 	uint16_t stamp_cur;
 	// check parameters
 #ifdef OS_PARAM_CHECK
@@ -167,7 +381,9 @@ uint8_t tmr_oneshot_set(struct tmr_oneshot *tmr, uint8_t flags, uint16_t elapse)
 #endif // !OS_TMR_TICK
 	}
 	// set the trigger timestamp
+#ifndef OS_TMR_WHEEL
 	tmr->stamp_trig = stamp_cur + elapse;
+#endif // OS_TMR_WHEEL
 	// insert timer to the queue
 	tmr_ons_insert(p_que, tmr, stamp_cur, elapse);
 	return 1;
@@ -175,7 +391,7 @@ uint8_t tmr_oneshot_set(struct tmr_oneshot *tmr, uint8_t flags, uint16_t elapse)
 
 // Cancels a pending one-shot timer.
 // Retuns zero if timer not found.
-// Note: This function is safe to call even if timer is not initialized.
+// Note: Timer handle must be initialized or zero-filled.
 uint8_t tmr_oneshot_cancel(struct tmr_oneshot *tmr)
 {
 #ifdef OS_PARAM_CHECK
@@ -184,6 +400,7 @@ uint8_t tmr_oneshot_cancel(struct tmr_oneshot *tmr)
 #endif // OS_PARAM_CHECK
 	if(!(tmr_oneshot_pending(tmr)))
 		return 0;
+#ifndef OS_TMR_WHEEL
 #ifdef OS_TMR_TICK
 	if((tmr_ons_tick != NULL) && tmr_ons_remove(&tmr_ons_tick, tmr))
 		return 1;
@@ -192,6 +409,14 @@ uint8_t tmr_oneshot_cancel(struct tmr_oneshot *tmr)
 	if((tmr_ons_sec != NULL) && tmr_ons_remove(&tmr_ons_sec, tmr))
 		return 1;
 #endif // OS_TMR_SECOND
+#else // OS_TMR_WHEEL
+	if(tmr->node.p_prev != NULL) {
+		tmr_ons_que_t *p_que = tmr_ons_unitque(tmr->node.unit);
+		tmr_whl_remove(p_que, &(tmr->node),
+			tmr_ons_istick(p_que) ? OS_QUE_ST_TMR_ONS_TICK : OS_QUE_ST_TMR_ONS_SEC);
+		return 1;
+	}
+#endif // OS_TMR_WHEEL
 	return task_cancel(&(tmr->task));
 }
 
@@ -202,6 +427,18 @@ uint8_t tmr_oneshot_cancel(struct tmr_oneshot *tmr)
 
 #ifdef OS_TMR_INTERVAL
 
+#ifdef OS_STATS
+// Updates the max lateness of the triggered interval timer.
+static void tmr_int_stat_late(tmr_int_que_t *p_que, uint16_t late)
+{
+	uint16_t *p_max = tmr_int_istick(p_que) ? &os_stats.tmr_late_tick : &os_stats.tmr_late_sec;
+	if(late > *p_max)
+		*p_max = late;
+}
+#endif // OS_STATS
+
+#ifndef OS_TMR_WHEEL
+
 // Inserts interval timer to the queue.
 // (keeps queue sorted by the next trigger timestamp)
 static void tmr_int_insert(struct tmr_interval **p_que,
@@ -255,6 +492,9 @@ void tmr_int_sched(struct tmr_interval **p_que, uint16_t stamp_cur, uint8_t prio
 		elap = tmr->stamp_trig - stamp_cur;
 		if((elap != 0) && (elap <= TMR_ELAPSE_MAX))
 			break;
+#ifdef OS_STATS
+		tmr_int_stat_late(p_que, -elap);
+#endif // OS_STATS
 		// remove timer from the queue
 		*p_que = tmr->next;
 		tmr->next = (void*)-1;
@@ -269,6 +509,9 @@ void tmr_int_sched(struct tmr_interval **p_que, uint16_t stamp_cur, uint8_t prio
 			if(elap > TMR_ELAPSE_MAX) {
 				tmr->stamp_trig = stamp_cur;
 				elap = 0;
+#ifdef OS_STATS
+				os_stats.tmr_slips++;
+#endif // OS_STATS
 			}
 			// insert timer back to the queue
 			tmr_int_insert(p_que, tmr, stamp_cur, elap);
@@ -278,14 +521,117 @@ void tmr_int_sched(struct tmr_interval **p_que, uint16_t stamp_cur, uint8_t prio
 	}
 }
 
+// Returns the number of time units until the next interval timer is triggered.
+#ifndef OS_TMR_SLACK
+uint16_t tmr_int_next(tmr_int_que_t *p_que, uint16_t stamp_cur)
+{
+	uint16_t elap;
+	if(task_pending(&((*p_que)->task)))
+		return 0;
+	elap = (*p_que)->stamp_trig - stamp_cur;
+	return (elap <= TMR_ELAPSE_MAX) ? elap : 0;
+}
+#else // OS_TMR_SLACK
+uint16_t tmr_int_next(tmr_int_que_t *p_que, uint16_t stamp_cur)
+{
+	// earliest trigger + slack, queue is sorted by the trigger
+	struct tmr_interval *tmr;
+	uint16_t next = 0xffff;
+	if(task_pending(&((*p_que)->task)))
+		return 0;
+	for(tmr = *p_que; tmr != NULL; tmr = tmr->next) {
+		uint16_t elap = tmr->stamp_trig - stamp_cur;
+		if(elap > TMR_ELAPSE_MAX)
+			elap = 0;
+		if(elap >= next)
+			break;
+		elap += tmr->slack;
+		if(elap < next)
+			next = elap;
+	}
+	return next;
+}
+#endif // OS_TMR_SLACK
+
+#else // OS_TMR_WHEEL
+
+#define tmr_int_of(p_node) \
+	((struct tmr_interval*)((uint8_t*)(p_node) - offsetof(struct tmr_interval, node)))
+
+// Inserts interval timer to the wheel.
+static void tmr_int_insert(tmr_int_que_t *p_que,
+	struct tmr_interval *tmr, uint16_t stamp_cur, uint16_t elapse)
+{
+	tmr->node.stamp_trig = stamp_cur + elapse;
+	tmr->node.unit = tmr_int_istick(p_que) ? TMR_UNIT_TICK : TMR_UNIT_SECOND;
+	tmr_whl_insert(p_que, &(tmr->node), stamp_cur,
+		tmr_int_istick(p_que) ? OS_QUE_ST_TMR_INT_TICK : OS_QUE_ST_TMR_INT_SEC);
+}
+
+// Schedules tasks for the interval timer wheel until no more triggered timers.
+void tmr_int_sched(tmr_int_que_t *p_que, uint16_t stamp_cur, uint8_t priority)
+{
+	struct tmr_node *node, *next;
+	tmr_whl_advance(p_que, stamp_cur);
+	// schedule the triggered timer tasks
+	node = p_que->due;
+	p_que->due = NULL;
+	for(; node != NULL; node = next) {
+		struct tmr_interval *tmr = tmr_int_of(node);
+		next = node->next;
+		// keep the timer triggered until the pending timer task executes
+		if(task_pending(&(tmr->task))) {
+			tmr_node_link(&(p_que->due), node);
+			continue;
+		}
+#ifdef OS_STATS
+		tmr_int_stat_late(p_que, stamp_cur - node->stamp_trig);
+#endif // OS_STATS
+		// restart the timer if interval is nonzero
+		if(tmr->interval != 0) {
+			// update the trigger timestamp
+			// slip the trigger if the updated timestamp already elapsed
+			node->stamp_trig += tmr->interval;
+			if((uint16_t)(node->stamp_trig - stamp_cur) > TMR_ELAPSE_MAX) {
+				node->stamp_trig = stamp_cur;
+#ifdef OS_STATS
+				os_stats.tmr_slips++;
+#endif // OS_STATS
+			}
+			// link timer back to the wheel
+			tmr_whl_place(p_que, node);
+		} else {
+			node->p_prev = NULL;
+			p_que->cnt--;
+		}
+		// schedule the task
+		task_schedule(&(tmr->task), priority);
+	}
+	if(p_que->cnt == 0)
+		os_que_st &= tmr_int_istick(p_que) ? ~OS_QUE_ST_TMR_INT_TICK : ~OS_QUE_ST_TMR_INT_SEC;
+}
+
+// Returns the number of time units until the next interval timer is triggered.
+uint16_t tmr_int_next(tmr_int_que_t *p_que, uint16_t stamp_cur)
+{
+	return tmr_whl_next(p_que, stamp_cur);
+}
+
+#endif // OS_TMR_WHEEL
+
 // Initializes an interval timer handle.
 // It is recommended to initialize timer handles once as a part of process initialization.
 // Note: Never call for an active timer.
 void tmr_interval_init(struct tmr_interval *tmr, tmr_interval_func_t func, uint16_t interval)
 {
 	tmr->task.next = (void*)-1;
+	tmr->task.p_prev = NULL;
 	tmr->task.func = (task_func_t) func;
+#ifndef OS_TMR_WHEEL
 	tmr->next = (void*)-1;
+#else // OS_TMR_WHEEL
+	tmr->node.p_prev = NULL;
+#endif // OS_TMR_WHEEL
 	tmr->interval = interval;
 }
 
@@ -295,7 +641,7 @@ void tmr_interval_init(struct tmr_interval *tmr, tmr_interval_func_t func, uint1
 //       and with low priority for a second-unit timer.
 uint8_t tmr_interval_set(struct tmr_interval *tmr, uint8_t flags, uint16_t elapse)
 {
-	struct tmr_interval **p_que;
+	tmr_int_que_t *p_que;
 	uint16_t stamp_cur;
 
 #ifdef OS_PARAM_CHECK
@@ -328,7 +674,9 @@ uint8_t tmr_interval_set(struct tmr_interval *tmr, uint8_t flags, uint16_t elaps
 #endif // !OS_TMR_TICK
 	}
 	// set the trigger timestamp
+#ifndef OS_TMR_WHEEL
 	tmr->stamp_trig = stamp_cur + elapse;
+#endif // OS_TMR_WHEEL
 	// insert timer to the queue
 	tmr_int_insert(p_que, tmr, stamp_cur, elapse);
 	return 1;
@@ -336,7 +684,7 @@ uint8_t tmr_interval_set(struct tmr_interval *tmr, uint8_t flags, uint16_t elaps
 
 // Cancels an active interval timer (and the timer task, if scheduled).
 // Retuns zero if timer not found.
-// Note: This function is safe to call even if timer is not initialized.
+// Note: Timer handle must be initialized or zero-filled.
 uint8_t tmr_interval_cancel(struct tmr_interval *tmr)
 {
 	uint8_t result = 0;
@@ -344,6 +692,7 @@ uint8_t tmr_interval_cancel(struct tmr_interval *tmr)
 	if(tmr == NULL)
 		return 0;
 #endif // OS_PARAM_CHECK
+#ifndef OS_TMR_WHEEL
 #ifdef OS_TMR_TICK
 	if((tmr_int_tick != NULL) && tmr_int_remove(&tmr_int_tick, tmr))
 		result = 1;
@@ -352,6 +701,14 @@ uint8_t tmr_interval_cancel(struct tmr_interval *tmr)
 	if(!result && (tmr_int_sec != NULL) && tmr_int_remove(&tmr_int_sec, tmr))
 		result = 1;
 #endif // OS_TMR_SECOND
+#else // OS_TMR_WHEEL
+	if(tmr->node.p_prev != NULL) {
+		tmr_int_que_t *p_que = tmr_int_unitque(tmr->node.unit);
+		tmr_whl_remove(p_que, &(tmr->node),
+			tmr_int_istick(p_que) ? OS_QUE_ST_TMR_INT_TICK : OS_QUE_ST_TMR_INT_SEC);
+		result = 1;
+	}
+#endif // OS_TMR_WHEEL
 	if(task_pending(&(tmr->task)) && task_cancel(&(tmr->task)))
 		result = 1;
 	return result;
@@ -359,6 +716,98 @@ uint8_t tmr_interval_cancel(struct tmr_interval *tmr)
 
 #endif // OS_TMR_INTERVAL
 
+// -------------------------------------------------------------------------------------------------
+// RTC timer
+
+#ifdef OS_TMR_RTC
+
+// RTC timer queue, sorted by the trigger timestamp.
+// Not part of the tickless deadline, RTC counter update wakes the CPU anyway.
+static struct tmr_rtc *tmr_rtc_que;
+
+// Initializes an RTC timer handle.
+// Note: Never call for a pending timer.
+void tmr_rtc_init(struct tmr_rtc *tmr, tmr_rtc_func_t func)
+{
+	tmr->task.next = (void*)-1;
+	tmr->task.p_prev = NULL;
+	tmr->task.func = (task_func_t) func;
+}
+
+// Starts or updates an initialized RTC timer to trigger at the RTC counter value stamp.
+uint8_t tmr_rtc_set_at(struct tmr_rtc *tmr, uint32_t stamp)
+{
+	struct tmr_rtc **p_ent = &tmr_rtc_que, *ent;
+	uint32_t stamp_cur = OS_TMR_RTC_READ();
+	uint32_t elapse = stamp - stamp_cur;
+	// check parameters
+#ifdef OS_PARAM_CHECK
+	if((tmr == NULL) || (tmr->task.func == NULL))
+		return 0;
+#endif // OS_PARAM_CHECK
+	// cancel the pending timer
+	if(tmr_rtc_pending(tmr) && !tmr_rtc_cancel(tmr))
+		return 0;
+	// insert timer to the queue, past stamp first. queue head read after the cancel
+	if(elapse > TMR_RTC_ELAPSE_MAX)
+		elapse = 0;
+	ent = *p_ent;
+	while(ent != NULL) {
+		uint32_t ent_elap = ent->stamp_trig - stamp_cur;
+		if(ent_elap > TMR_RTC_ELAPSE_MAX)
+			ent_elap = 0;
+		if(ent_elap > elapse)
+			break;
+		p_ent = (struct tmr_rtc**) &(ent->task.next);
+		ent = *p_ent;
+	}
+	tmr->stamp_trig = stamp;
+	tmr->task.next = (struct task_handle*) ent;
+	*p_ent = tmr;
+	return 1;
+}
+
+// Cancels a pending RTC timer.
+uint8_t tmr_rtc_cancel(struct tmr_rtc *tmr)
+{
+	struct tmr_rtc **p_ent = &tmr_rtc_que, *ent = *p_ent;
+#ifdef OS_PARAM_CHECK
+	if(tmr == NULL)
+		return 0;
+#endif // OS_PARAM_CHECK
+	if(!(tmr_rtc_pending(tmr)))
+		return 0;
+	// find the pending timer
+	while(ent != NULL) {
+		if(ent == tmr) {
+			*p_ent = (struct tmr_rtc*) tmr->task.next;
+			tmr->task.next = (void*)-1;
+			return 1;
+		}
+		p_ent = (struct tmr_rtc**) &(ent->task.next);
+		ent = *p_ent;
+	}
+	return task_cancel(&(tmr->task));
+}
+
+// Schedules tasks for the triggered RTC timers.
+void tmr_rtc_sched()
+{
+	uint32_t stamp_cur = OS_TMR_RTC_READ();
+	for(;;) {
+		struct tmr_rtc *tmr = tmr_rtc_que;
+		// exit if queue empty or the timer not yet triggered
+		if((tmr == NULL) || ((int32_t)(tmr->stamp_trig - stamp_cur) > 0))
+			break;
+		// remove timer from the queue, schedule the task
+		tmr_rtc_que = (struct tmr_rtc*) tmr->task.next;
+		tmr->task.next = (void*)-1;
+		task_schedule(&(tmr->task), TASK_PRIORITY_LOW);
+	}
+}
+
+#endif // OS_TMR_RTC
+
 // -------------------------------------------------------------------------------------------------
 
 #endif // OS_TMR
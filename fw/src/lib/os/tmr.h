@@ -4,6 +4,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 #include "task.h"
 #include "os_cfg.h"
 
@@ -11,11 +12,41 @@
 
 #ifdef OS_TMR
 
+#if (defined OS_TMR_SLACK) && (defined OS_TMR_WHEEL)
+  #error OS_TMR_SLACK requires the sorted list timer queues
+#endif // OS_TMR_SLACK && OS_TMR_WHEEL
+
 #define TMR_ELAPSE_MAX				50000
 
 #define TMR_UNIT_TICK				0x00
 #define TMR_UNIT_SECOND				0x01
 
+// -------------------------------------------------------------------------------------------------
+// Timing wheel
+
+#ifdef OS_TMR_WHEEL
+
+#define TMR_WHEEL_SLOTS				(1 << OS_TMR_WHEEL_BITS)
+#define TMR_WHEEL_LEVELS			((16 + OS_TMR_WHEEL_BITS - 1) / OS_TMR_WHEEL_BITS)
+
+// Timing wheel link. internal use only.
+struct tmr_node {
+	struct tmr_node *next;			// next timer in the slot.
+	struct tmr_node **p_prev;		// previous link pointing to this timer, NULL if not linked.
+	uint16_t stamp_trig;			// next trigger timestamp.
+	uint8_t unit;					// timer time unit.
+};
+
+// Timing wheel. internal use only.
+struct tmr_wheel {
+	uint16_t stamp;					// last processed timestamp.
+	uint8_t cnt;					// number of linked timers.
+	struct tmr_node *due;			// triggered timers waiting for the task schedule.
+	struct tmr_node *slot[TMR_WHEEL_LEVELS][TMR_WHEEL_SLOTS];
+};
+
+#endif // OS_TMR_WHEEL
+
 // -------------------------------------------------------------------------------------------------
 // One-shot timer
 
@@ -25,17 +56,39 @@
 // Use tmr_oneshot_init to initialize, do not modify it directly.
 // Note: Wrap into a custom structure to pass arguments to the handler.
 // Note: Never modify or dispose handle of a pending timer.
+// (Exception: slack field can be safely changed at any time).
+#ifndef OS_TMR_WHEEL
 struct tmr_oneshot {
 	struct task_handle task;		// task.next is reused for the next timer. internal use only.
 	uint16_t stamp_trig;			// next trigger timestamp. internal use only.
+#ifdef OS_TMR_SLACK
+	uint8_t slack;					// allowed trigger delay in base units.
+#endif // OS_TMR_SLACK
 };
+#else // OS_TMR_WHEEL
+struct tmr_oneshot {
+	struct task_handle task;		// timer task. internal use only.
+	struct tmr_node node;			// timing wheel link. internal use only.
+};
+#endif // OS_TMR_WHEEL
 
 // One-shot timer static initialization.
-#define TMR_ONESHOT(func) { { (void*)-1, (task_func_t)func }, 0 }
+#ifndef OS_TMR_WHEEL
+#define TMR_ONESHOT(func) { { (void*)-1, NULL, (task_func_t)func }, 0 }
+#ifdef OS_TMR_SLACK
+#define TMR_ONESHOT_SLACK(func, slack) { { (void*)-1, NULL, (task_func_t)func }, 0, slack }
+#endif // OS_TMR_SLACK
+#else // OS_TMR_WHEEL
+#define TMR_ONESHOT(func) { { (void*)-1, NULL, (task_func_t)func }, { NULL, NULL, 0, 0 } }
+#endif // OS_TMR_WHEEL
 
 // Checks an initialized one-shot timer state.
 // Returns nonzero if timer pending.
+#ifndef OS_TMR_WHEEL
 #define tmr_oneshot_pending(tmr)	((tmr)->task.next != (void*)-1)
+#else // OS_TMR_WHEEL
+#define tmr_oneshot_pending(tmr)	(((tmr)->node.p_prev != NULL) || task_pending(&((tmr)->task)))
+#endif // OS_TMR_WHEEL
 
 // One-shot timer function.
 typedef void (*tmr_oneshot_func_t)(struct tmr_oneshot *tmr);
@@ -53,7 +106,7 @@ uint8_t tmr_oneshot_set(struct tmr_oneshot *tmr, uint8_t flags, uint16_t elapse)
 
 // Cancels a pending one-shot timer.
 // Retuns zero if timer not found.
-// Note: This function is safe to call even if timer is not initialized.
+// Note: Timer handle must be initialized or zero-filled.
 uint8_t tmr_oneshot_cancel(struct tmr_oneshot *tmr);
 
 #endif // OS_TMR_ONESHOT
@@ -67,20 +120,43 @@ uint8_t tmr_oneshot_cancel(struct tmr_oneshot *tmr);
 // Use tmr_interval_init to initialize, do not modify it directly.
 // Note: Wrap into a custom structure to pass arguments to the timer function.
 // Note: Never modify or dispose handle of an active timer.
-// (Exception: interval field can be safely changed at any time).
+// (Exception: interval and slack fields can be safely changed at any time).
+#ifndef OS_TMR_WHEEL
 struct tmr_interval {
 	struct task_handle task;		// timer task. internal use only.
 	struct tmr_interval *next;		// next timer. internal use only.
 	uint16_t stamp_trig;			// next trigger timestamp. internal use only.
 	uint16_t interval;				// timer interval in base units.
+#ifdef OS_TMR_SLACK
+	uint8_t slack;					// allowed trigger delay in base units.
+#endif // OS_TMR_SLACK
 };
+#else // OS_TMR_WHEEL
+struct tmr_interval {
+	struct task_handle task;		// timer task. internal use only.
+	struct tmr_node node;			// timing wheel link. internal use only.
+	uint16_t interval;				// timer interval in base units.
+};
+#endif // OS_TMR_WHEEL
 
 // One-shot timer static initialization.
-#define TMR_INTERVAL(func, interval) { { (void*)-1, (task_func_t)func }, (void*)-1, 0, interval }
+#ifndef OS_TMR_WHEEL
+#define TMR_INTERVAL(func, interval) { { (void*)-1, NULL, (task_func_t)func }, (void*)-1, 0, interval }
+#ifdef OS_TMR_SLACK
+#define TMR_INTERVAL_SLACK(func, interval, slack) \
+	{ { (void*)-1, NULL, (task_func_t)func }, (void*)-1, 0, interval, slack }
+#endif // OS_TMR_SLACK
+#else // OS_TMR_WHEEL
+#define TMR_INTERVAL(func, interval) { { (void*)-1, NULL, (task_func_t)func }, { NULL, NULL, 0, 0 }, interval }
+#endif // OS_TMR_WHEEL
 
 // Checks the initialized interval timer state.
 // Returns nonzero if timer is active.
+#ifndef OS_TMR_WHEEL
 #define tmr_interval_active(tmr)	((tmr)->next != (void*)-1)
+#else // OS_TMR_WHEEL
+#define tmr_interval_active(tmr)	((tmr)->node.p_prev != NULL)
+#endif // OS_TMR_WHEEL
 
 // Interval timer function.
 typedef void (*tmr_interval_func_t)(struct tmr_interval *tmr);
@@ -98,40 +174,115 @@ uint8_t tmr_interval_set(struct tmr_interval *tmr, uint8_t flags, uint16_t elaps
 
 // Cancels an active interval timer (and the timer task, if scheduled).
 // Retuns zero if timer not found.
-// Note: This function is safe to call even if timer is not initialized.
+// Note: Timer handle must be initialized or zero-filled.
 uint8_t tmr_interval_cancel(struct tmr_interval *tmr);
 
 #endif // OS_TMR_INTERVAL
 
+// -------------------------------------------------------------------------------------------------
+// RTC timer
+
+#ifdef OS_TMR_RTC
+
+#define TMR_RTC_ELAPSE_MAX			0x7FFFFFFF
+
+// RTC timer handle, one-shot timer on the RTC second counter (OS_TMR_RTC_READ).
+// Use tmr_rtc_init to initialize, do not modify it directly.
+// Note: Never modify or dispose handle of a pending timer.
+struct tmr_rtc {
+	struct task_handle task;		// task.next is reused for the next timer. internal use only.
+	uint32_t stamp_trig;			// trigger timestamp. internal use only.
+};
+
+// RTC timer static initialization.
+#define TMR_RTC(func) { { (void*)-1, NULL, (task_func_t)func }, 0 }
+
+// Checks an initialized RTC timer state.
+// Returns nonzero if timer pending.
+#define tmr_rtc_pending(tmr)		((tmr)->task.next != (void*)-1)
+
+// RTC timer function.
+typedef void (*tmr_rtc_func_t)(struct tmr_rtc *tmr);
+
+// Initializes an RTC timer handle.
+// Note: Never call for a pending timer.
+void tmr_rtc_init(struct tmr_rtc *tmr, tmr_rtc_func_t func);
+
+// Starts or updates an initialized RTC timer to trigger at the RTC counter value stamp.
+// Timer is triggered by the first tmr_rtc_sched call with the counter at or past stamp,
+// stamp up to TMR_RTC_ELAPSE_MAX seconds in the past triggers on the next call.
+// Note: Timer function is executed with low priority.
+uint8_t tmr_rtc_set_at(struct tmr_rtc *tmr, uint32_t stamp);
+
+// Starts or updates an initialized RTC timer to trigger in elapse seconds.
+#define tmr_rtc_set(tmr, elapse)	tmr_rtc_set_at(tmr, OS_TMR_RTC_READ() + (elapse))
+
+// Cancels a pending RTC timer.
+// Retuns zero if timer not found.
+// Note: Timer handle must be initialized or zero-filled.
+uint8_t tmr_rtc_cancel(struct tmr_rtc *tmr);
+
+// Schedules tasks for the triggered RTC timers. Call after each RTC counter update.
+void tmr_rtc_sched();
+
+#endif // OS_TMR_RTC
+
 // -------------------------------------------------------------------------------------------------
 // OS internal
 
+// Timer queue types.
+#ifndef OS_TMR_WHEEL
+  #ifdef OS_TMR_ONESHOT
+    typedef struct tmr_oneshot *tmr_ons_que_t;
+  #endif // OS_TMR_ONESHOT
+  #ifdef OS_TMR_INTERVAL
+    typedef struct tmr_interval *tmr_int_que_t;
+  #endif // OS_TMR_INTERVAL
+#else // OS_TMR_WHEEL
+  #ifdef OS_TMR_ONESHOT
+    typedef struct tmr_wheel tmr_ons_que_t;
+  #endif // OS_TMR_ONESHOT
+  #ifdef OS_TMR_INTERVAL
+    typedef struct tmr_wheel tmr_int_que_t;
+  #endif // OS_TMR_INTERVAL
+#endif // OS_TMR_WHEEL
+
 #ifdef OS_TMR_ONESHOT
   #ifdef OS_TMR_TICK
     #define OS_QUE_ST_TMR_ONS_TICK	0x10	// one-shot tick queue is not empty
-    extern struct tmr_oneshot *tmr_ons_tick;
+    extern tmr_ons_que_t tmr_ons_tick;
   #endif // OS_TMR_TICK
   #ifdef OS_TMR_SECOND
     #define OS_QUE_ST_TMR_ONS_SEC	0x20	// one-shot second queue is not empty
-    extern struct tmr_oneshot *tmr_ons_sec;
+    extern tmr_ons_que_t tmr_ons_sec;
   #endif // OS_TMR_SECOND
   // Schedules tasks for the one-shot timer queue until no more triggered timers.
-  void tmr_ons_sched(struct tmr_oneshot **p_que, uint16_t stamp_cur, uint8_t priority);
+  void tmr_ons_sched(tmr_ons_que_t *p_que, uint16_t stamp_cur, uint8_t priority);
+  // Returns the number of time units until the next one-shot timer is triggered.
+  // Returns zero if timer already triggered. Result can be less than the exact value.
+  // OS_TMR_SLACK: returns the earliest trigger + slack over the queue instead.
+  // Note: queue must not be empty, function does not check for it.
+  uint16_t tmr_ons_next(tmr_ons_que_t *p_que, uint16_t stamp_cur);
 #endif // OS_TMR_ONESHOT
 
 #ifdef OS_TMR_INTERVAL
   #ifdef OS_TMR_TICK
     #define OS_QUE_ST_TMR_INT_TICK	0x40	// interval tick queue is not empty
-    extern struct tmr_interval *tmr_int_tick;
+    extern tmr_int_que_t tmr_int_tick;
   #endif // OS_TMR_TICK
   #ifdef OS_TMR_SECOND
     #define OS_QUE_ST_TMR_INT_SEC	0x80	// interval second queue is not empty
-    extern struct tmr_interval *tmr_int_sec;
+    extern tmr_int_que_t tmr_int_sec;
   #endif // OS_TMR_SECOND
   // Schedules task for the next interval timer.
   // Returns zero if next timer not yet triggered, or if timer task already pending.
   // Note: next timer must exist in the queue, function does not check for it.
-  void tmr_int_sched(struct tmr_interval **p_queue, uint16_t stamp_cur, uint8_t priority);
+  void tmr_int_sched(tmr_int_que_t *p_queue, uint16_t stamp_cur, uint8_t priority);
+  // Returns the number of time units until the next interval timer is triggered.
+  // Returns zero if timer already triggered. Result can be less than the exact value.
+  // OS_TMR_SLACK: returns the earliest trigger + slack over the queue instead.
+  // Note: queue must not be empty, function does not check for it.
+  uint16_t tmr_int_next(tmr_int_que_t *p_que, uint16_t stamp_cur);
 #endif // OS_TMR_INTERVAL
 
 #define OS_QUE_ST_TMR_ANY			0xF0	// any timer queue is not empty
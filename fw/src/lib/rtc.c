@@ -0,0 +1,25 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "rtc.h"
+
+// -------------------------------------------------------------------------------------------------
+
+// Timer2 overflow counter (rtc_int.S)
+extern uint8_t t_rtc_ovf;
+
+uint16_t rtc_time()
+{
+	uint8_t ovf, cnt;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ovf = t_rtc_ovf;
+		cnt = TCNT2;
+		// overflow interrupt not yet served
+		if((TIFR2 & (1<<TOV2)) && (cnt < 0x80))
+			ovf++;
+	}
+	return ((uint16_t)ovf << 8) | cnt;
+}
+
+// -------------------------------------------------------------------------------------------------
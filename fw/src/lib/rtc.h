@@ -7,5 +7,12 @@
 // -------------------------------------------------------------------------------------------------
 
 extern uint32_t t_rtc_sec;
+extern uint8_t t_tick_cmp;		// Timer2 count of the next OS tick
+
+// RTC counter time (Timer2 overflows and count), runs in all sleep modes.
+#define RTC_TIME_FREQ		128
+
+// Returns the RTC counter time, 1/RTC_TIME_FREQ s, wraps every 512s.
+uint16_t rtc_time();
 
 // -------------------------------------------------------------------------------------------------
@@ -0,0 +1,35 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include "sleep_gov.h"
+#include "../hwconf.h"
+
+// -------------------------------------------------------------------------------------------------
+
+// Returns the sleep mode, n is the number of ticks until the next timer deadline.
+uint8_t sleep_gov_mode(uint16_t n)
+{
+	// Timer0 (display), Timer1 (buzzer), SPI and USART run on the I/O clock
+	if( DISP_IS_ON() || BUZZ_IS_ON() ||
+		(~PRR & ((1<<PRSPI)|(1<<PRUSART0))) )
+	{
+		return SLEEP_MODE_IDLE;
+	}
+	// ADC conversion. ADC noise reduction wakes up by the EEPROM ready too.
+	// (entering it with an idle ADC enabled would start a conversion)
+	if(ADCSRA & (1<<ADSC))
+		return SLEEP_MODE_ADC;
+	// EEPROM ready interrupt can't wake up from power save
+	if(EECR & (1<<EERIE))
+		return SLEEP_MODE_IDLE;
+	// Timer2 (RTC, system tick, tickless wakeup) and pin change interrupts only
+	RTC_SLEEP_SYNC();
+#if SLEEP_STANDBY_TICKS > 0
+	if(n < SLEEP_STANDBY_TICKS)
+		return SLEEP_MODE_EXT_STANDBY;
+#endif // SLEEP_STANDBY_TICKS
+	return SLEEP_MODE_PWR_SAVE;
+}
+
+// -------------------------------------------------------------------------------------------------
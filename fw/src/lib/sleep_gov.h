@@ -0,0 +1,15 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------------------------------------
+// Sleep mode governor: the deepest sleep mode keeping the active peripherals running,
+// selected for each idle period by the OS (OS_SLEEP_MODE).
+
+// Returns the sleep mode, n is the number of ticks until the next timer deadline.
+// Called with interrupts disabled.
+uint8_t sleep_gov_mode(uint16_t n);
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,46 @@
+// -------------------------------------------------------------------------------------------------
+
+#include <avr/io.h>
+#include "rtc.h"
+#include "tickless.h"
+#include "../hwconf.h"
+
+// -------------------------------------------------------------------------------------------------
+
+static uint8_t tl_cnt;			// Timer2 count of the last tick before the stop
+
+// Returns nonzero if the tick source can be stopped.
+uint8_t tickless_allowed()
+{
+	return TICK_IS_ON();
+}
+
+// Stops the tick source, sets up a wakeup in n ticks or earlier.
+// Returns zero if the wakeup interval is too short.
+uint8_t tickless_start(uint16_t n)
+{
+	// one tick per Timer2 count. TCNT2 may be 1 count past the last tick,
+	// OCR2A needs 2 more counts to latch.
+	if(n < 3)
+		return 0;
+	if(n > 250)
+		n = 250;
+	TICK_STOP();
+	tl_cnt = t_tick_cmp - 1;
+	TICKLESS_WAKE_SET((uint8_t)(tl_cnt + n));
+	return 1;
+}
+
+// Restarts the tick source. Returns the number of ticks elapsed.
+uint16_t tickless_stop()
+{
+	uint8_t cnt;
+	TICKLESS_WAKE_CLR();
+	RTC_SLEEP_SYNC();
+	cnt = TCNT2;
+	// restart 2 counts later (OCR2B latch), the skipped count is accounted now
+	TICK_START(cnt + 2);
+	return (uint8_t)(cnt + 1 - tl_cnt);
+}
+
+// -------------------------------------------------------------------------------------------------
@@ -0,0 +1,21 @@
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+// -------------------------------------------------------------------------------------------------
+// Tickless idle: Timer2 compare B system tick is stopped while idle,
+// Timer2 compare A wakes up the MCU at the next timer deadline.
+
+// Returns nonzero if the tick source can be stopped.
+uint8_t tickless_allowed();
+
+// Stops the tick source, sets up a wakeup in n ticks or earlier.
+// Returns zero if the wakeup interval is too short.
+uint8_t tickless_start(uint16_t n);
+
+// Restarts the tick source. Returns the number of ticks elapsed.
+uint16_t tickless_stop();
+
+// -------------------------------------------------------------------------------------------------
@@ -8,6 +8,9 @@
 #include "lib/os/os.h"
 #include "lib/adc.h"
 #include "lib/rtc.h"
+#include "lib/ee.h"
+#include "lib/clk.h"
+#include "lib/energy.h"
 #include "ro.h"
 #include "menu.h"
 #include "config.h"
@@ -21,13 +24,16 @@ static uint8_t is_pwr_on;
 
 static void pwr_on()
 {
-	TICK_DISP_ENABLE();					// enable display and system tick
+	TICK_ENABLE();						// enable system tick
 	adc_read_enable(adc_callback);		// enable ADC refresh
+	energy_set(EN_ADC, 1);
 	menu_enable();						// enable ui
 	ro_enable();						// enable RO controller
 
 	// power on mode
+#ifndef OS_SLEEP_GOV
 	set_sleep_mode(SLEEP_MODE_IDLE);
+#endif // OS_SLEEP_GOV
 	is_pwr_on = 1;
 }
 
@@ -36,13 +42,28 @@ static void pwr_off()
 	ro_disable();						// disable RO controller
 	menu_disable();						// disable ui
 	adc_read_disable();					// disable ADC refresh
-	TICK_DISP_DISABLE();				// disable display and system tick
-
-	// power save mode
-	set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+	energy_set(EN_ADC, 0);
+	TICK_DISABLE();						// disable system tick
+
+	// power save mode. EEPROM ready interrupt can't wake up from power save,
+	// stay in idle until the EEPROM write queue is empty.
+	// (selected for each idle period by the sleep mode governor)
+#ifndef OS_SLEEP_GOV
+	if(!ee_busy())
+		set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+#endif // OS_SLEEP_GOV
 	is_pwr_on = 0;
 }
 
+// EEPROM write queue empty
+static void ee_done(struct task_handle *task)
+{
+#ifndef OS_SLEEP_GOV
+	if(!is_pwr_on)
+		set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+#endif // OS_SLEEP_GOV
+}
+
 //--------------------------------------------------------------------------------------------------
 // ADC callback. 5-sample average: 0..(1024*5)
 
@@ -70,23 +91,32 @@ static void rtc_tick(struct task_handle *task)
 		pwr_on();
 	// update rtc second counter
 	t_rtc_sec += 2;
+#ifdef ENERGY_ACCT
+	energy_tick();
+#endif // ENERGY_ACCT
+#ifdef OS_TMR_RTC
+	tmr_rtc_sched();
+#endif // OS_TMR_RTC
 }
 
+struct task_handle rtc_tick_task = TASK_HANDLE(rtc_tick);
+
 static void rtc_init()
 {
-	static struct task_handle rtc_tick_task = TASK_HANDLE(rtc_tick);
 	RTC_TICK_INIT();
 	task_flag_bind(RTC_TICK_FLAG_ID, &rtc_tick_task, TASK_PRIORITY_NORMAL);
 }
 
 //--------------------------------------------------------------------------------------------------
 
+struct task_handle ee_done_task = TASK_HANDLE(ee_done);
+
 static void mcu_init()
 {
 	// initialize MCU
 	MCUSR = 0;
 	wdt_disable();
-	clock_prescale_set(clock_div_2); // F_CPU=4MHz
+	clock_prescale_set(clock_div_2); // F_CPU=4MHz, see clk.h
 	set_sleep_mode(SLEEP_MODE_PWR_SAVE);
 
 	// initialize GPIO
@@ -108,7 +138,9 @@ int main()
 	mcu_init();
 	os_init();
 	rtc_init();
+	ee_set_done_task(&ee_done_task);
 	ro_load_ee();
+	clk_fast_end();						// boot done, low speed
 	os_run();
 }
 
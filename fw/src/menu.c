@@ -5,6 +5,9 @@
 #include <avr/pgmspace.h>
 #include "lib/os/os.h"
 #include "lib/disp.h"
+#include "lib/btn.h"
+#include "lib/clk.h"
+#include "lib/energy.h"
 #include "ro.h"
 #include "menu.h"
 #include "config.h"
@@ -18,12 +21,32 @@ extern uint16_t vin;
 // -------------------------------------------------------------------------------------------------
 // Beep
 
-static uint8_t beep_tmr;
+// Timer1 is the task profiling counter
+#ifdef OS_TASK_PROF
+  #undef BUZZ_ON
+  #undef BUZZ_OFF
+  #undef BUZZ_ENABLE
+  #undef BUZZ_DISABLE
+  #define BUZZ_ON()
+  #define BUZZ_OFF()
+  #define BUZZ_ENABLE()
+  #define BUZZ_DISABLE()
+#endif // OS_TASK_PROF
+
+static void beep_off(struct tmr_oneshot *tmr)
+{
+	BUZZ_OFF();
+	energy_set(EN_BUZZ, 0);
+}
+
+static struct tmr_oneshot beep_tmr = TMR_ONESHOT(beep_off);
 
+// Beep for dur*48ms
 void beep(uint8_t dur)
 {
 	BUZZ_ON();
-	beep_tmr = dur;
+	energy_set(EN_BUZZ, 1);
+	tmr_oneshot_set(&beep_tmr, TMR_UNIT_TICK, dur * T_MS(48));
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -87,7 +110,8 @@ static void disp_uint32(uint32_t val)
 	else disp_uint((uint16_t)(val / 1000), 3);
 }
 
-static void disp_spin()
+// Draws the spinner frame, step advances to the next frame.
+static void disp_spin(uint8_t step)
 {
 	static uint8_t n;
 	disp_buf[0] = 0;
@@ -105,27 +129,13 @@ static void disp_spin()
 	case 8: disp_buf[0] = 0x10; break;
 	case 9: disp_buf[0] = 0x20; break;
 	}
-	n = (n < 9) ? (n + 1) : 0;
+	if(step)
+		n = (n < 9) ? (n + 1) : 0;
 }
 
 // -------------------------------------------------------------------------------------------------
 // Menu update
 
-enum {
-	BTN_STATE_RELEASED,
-	BTN_STATE_PUSHED,
-	BTN_STATE_LONGPUSHED,
-};
-
-enum {
-	BTN_EV_NONE,
-	BTN_EV_PUSH,
-	BTN_EV_LONGPUSH,
-};
-
-static uint8_t btn_st = BTN_STATE_RELEASED;
-static uint8_t btn_tmr = 0;
-
 enum {
 	MENU_STATE_DISPLAY,
 	MENU_STATE_PARAM_SELECT,
@@ -166,37 +176,16 @@ static uint16_t menu_val_cur;
 static uint16_t menu_val_step;
 static uint16_t menu_hide_tmr;
 
-// 48ms timer
-static void menu_poll(struct tmr_interval *tmr)
+// Menu update for a button event
+static void menu_update(uint8_t btn_ev)
 {
-	uint8_t btn_ev = BTN_EV_NONE;
-
-	// -----------------------------------------------------
-	// Watchdog reset
-	wdt_reset();
-
 	// -----------------------------------------------------
-	// Beep update
-	if(BUZZ_IS_ON() && (--beep_tmr == 0))
-		BUZZ_OFF();
-
-	// -----------------------------------------------------
-	// Button poll
-	if(BTN_IS_PSH()) {
-		if(btn_st == BTN_STATE_RELEASED) {
-			btn_st = BTN_STATE_PUSHED;
-			beep(1);
-		}
-		if((btn_st == BTN_STATE_PUSHED) && (btn_tmr++ == BTN_LONGPUSH_THRES / 48)) {
-			btn_st = BTN_STATE_LONGPUSHED;
-			btn_ev = BTN_EV_LONGPUSH;
-			beep(5);
-		}
-	} else if(btn_st != BTN_STATE_RELEASED) {
-		if(btn_st == BTN_STATE_PUSHED)
-			btn_ev = BTN_EV_PUSH;
-		btn_st = BTN_STATE_RELEASED;
-		btn_tmr = 0;
+	// Button beep
+	if(btn_ev == BTN_EV_PRESS) {
+		beep(1);
+		btn_ev = BTN_EV_NONE;
+	} else if(btn_ev == BTN_EV_LONGPUSH) {
+		beep(5);
 	}
 
 	// -----------------------------------------------------
@@ -225,7 +214,8 @@ static void menu_poll(struct tmr_interval *tmr)
 			disp_uint((uint16_t)(ro_get_current_work_time() / 6), 2);
 			break;
 		case RO_FLUSH:
-			disp_spin();
+			// one frame per redraw: menu_run ends the queued events with BTN_EV_NONE
+			disp_spin(btn_ev == BTN_EV_NONE);
 			break;
 		case RO_NOWATER:
 			disp_msg(msg_dry);
@@ -454,16 +444,70 @@ static void menu_poll(struct tmr_interval *tmr)
 	}
 }
 
+// -------------------------------------------------------------------------------------------------
+// Menu events
+
+static void menu_refresh(struct tmr_interval *tmr);
+
+#ifndef OS_TMR_SLACK
+static struct tmr_interval menu_tmr = TMR_INTERVAL(menu_refresh, T_MS(480));
+#else // OS_TMR_SLACK
+static struct tmr_interval menu_tmr = TMR_INTERVAL_SLACK(menu_refresh, T_MS(480), T_MS(48));
+#endif // OS_TMR_SLACK
+
+// Processes the queued button events and redraws the display.
+// Display refresh period is 48ms for the flush animation, 480ms otherwise.
+static void menu_run()
+{
+	uint8_t btn_ev;
+	uint16_t interval;
+
+	wdt_reset();
+	do {
+		btn_ev = btn_ev_get();
+		menu_update(btn_ev);
+	} while(btn_ev != BTN_EV_NONE);
+	disp_commit();
+
+	interval = ((menu_state == MENU_STATE_DISPLAY) && (ro_get_state() == RO_FLUSH)) ?
+		T_MS(48) : T_MS(480);
+	if(menu_tmr.interval != interval) {
+		tmr_interval_cancel(&menu_tmr);
+		menu_tmr.interval = interval;
+#ifdef OS_TMR_SLACK
+		// refresh may be 10% late to share the wakeup
+		menu_tmr.slack = interval / 10;
+#endif // OS_TMR_SLACK
+		tmr_interval_set(&menu_tmr, TMR_UNIT_TICK, interval);
+	}
+}
+
+static void menu_refresh(struct tmr_interval *tmr)
+{
+	menu_run();
+}
+
+static void menu_btn_event(struct task_handle *task)
+{
+	clk_fast_begin();
+	menu_run();
+	clk_fast_end();
+}
+
 // -------------------------------------------------------------------------------------------------
 // Menu init
 
-static struct tmr_interval menu_tmr = TMR_INTERVAL(menu_poll, T_MS(48));
+static struct task_handle menu_btn_task = TASK_HANDLE(menu_btn_event);
 
 void menu_enable()
 {
-	wdt_enable(WDTO_250MS);
-	BTN_ENABLE();
+	wdt_enable(WDTO_1S);
+	btn_enable(&menu_btn_task);
 	BUZZ_ENABLE();
+	menu_tmr.interval = T_MS(480);
+#ifdef OS_TMR_SLACK
+	menu_tmr.slack = T_MS(48);
+#endif // OS_TMR_SLACK
 	tmr_interval_set(&menu_tmr, TMR_UNIT_TICK, 0);
 	menu_state = MENU_STATE_DISPLAY;
 	lamp_state = 0;
@@ -472,17 +516,17 @@ void menu_enable()
 void menu_disable()
 {
 	tmr_interval_cancel(&menu_tmr);
-	btn_st = BTN_STATE_RELEASED;
-	btn_tmr = 0;
+	task_cancel(&menu_btn_task);
+	btn_disable();
 
 	BUZZ_DISABLE();
-	beep_tmr = 0;
-
-	BTN_DISABLE();
+	energy_set(EN_BUZZ, 0);
+	tmr_oneshot_cancel(&beep_tmr);
 
 	disp_buf[0] = 0;
 	disp_buf[1] = 0;
 	disp_buf[2] = 0;
+	disp_commit();
 
 	wdt_disable();
 }
@@ -1,9 +1,15 @@
 // -------------------------------------------------------------------------------------------------
 
+#include <string.h>
 #include <avr/io.h>
 #include <avr/eeprom.h>
 #include "lib/os/os.h"
 #include "lib/rtc.h"
+#include "lib/ee.h"
+#include "lib/ee_ring.h"
+#include "lib/ee_log.h"
+#include "lib/clk.h"
+#include "lib/energy.h"
 #include "menu.h"
 #include "ro.h"
 #include "config.h"
@@ -14,57 +20,159 @@
 
 #define INLET_SW_ON()			DI_A_IS_ON()
 #define REFILL_SW_ON()			DI_B_IS_ON()
-#define WORK_ON()				DQ_A_ON()
-#define WORK_OFF()				DQ_A_OFF()
-#define BYPASS_ON()				DQ_B_ON()
-#define BYPASS_OFF()			DQ_B_OFF()
-#define LAMP_ON()				DQ_C_ON()
-#define LAMP_OFF()				DQ_C_OFF()
+#define WORK_ON()				do { DQ_A_ON(); energy_set(EN_WORK, 1); } while(0)
+#define WORK_OFF()				do { DQ_A_OFF(); energy_set(EN_WORK, 0); } while(0)
+#define BYPASS_ON()				do { DQ_B_ON(); energy_set(EN_BYPASS, 1); } while(0)
+#define BYPASS_OFF()			do { DQ_B_OFF(); energy_set(EN_BYPASS, 0); } while(0)
+#define LAMP_ON()				do { DQ_C_ON(); energy_set(EN_LAMP, 1); } while(0)
+#define LAMP_OFF()				do { DQ_C_OFF(); energy_set(EN_LAMP, 0); } while(0)
 
 extern uint16_t ain_c;
 
 // -------------------------------------------------------------------------------------------------
 // settings
 
-static uint8_t EEMEM ee_ro_cfg_off;
-static uint32_t EEMEM ee_ro_cfg_nowater_thres;
-static uint32_t EEMEM ee_ro_cfg_timeout_thres;
-static uint32_t EEMEM ee_ro_cfg_flush_work_thres;
-static uint32_t EEMEM ee_ro_cfg_flush_total_thres;
-static uint32_t EEMEM ee_ro_cfg_auto_flush_time;
-static uint32_t EEMEM ee_ro_cfg_man_flush_time;
-static uint32_t EEMEM ee_ro_cfg_extra_time;
-
-static uint8_t ro_cfg_off							= 0;
-static uint32_t ro_cfg_nowater_thres				= RO_CFG_NOWATER_THRES;
-static uint32_t ro_cfg_timeout_thres				= RO_CFG_TIMEOUT_THRES;
-static uint32_t ro_cfg_flush_work_thres				= RO_CFG_FLUSH_WORK_THRES;
-static uint32_t ro_cfg_flush_total_thres			= RO_CFG_FLUSH_TOTAL_THRES;
-static uint32_t ro_cfg_auto_flush_time				= RO_CFG_AUTO_FLUSH_TIME;
-static uint32_t ro_cfg_man_flush_time				= RO_CFG_MAN_FLUSH_TIME;
-static uint32_t ro_cfg_extra_time					= RO_CFG_EXTRA_TIME;
+struct ro_cfg {
+	uint8_t off;
+	uint32_t nowater_thres;
+	uint32_t timeout_thres;
+	uint32_t flush_work_thres;
+	uint32_t flush_total_thres;
+	uint32_t auto_flush_time;
+	uint32_t man_flush_time;
+	uint32_t extra_time;
+};
+
+static struct ro_cfg ro_cfg = {
+	0,
+	RO_CFG_NOWATER_THRES,
+	RO_CFG_TIMEOUT_THRES,
+	RO_CFG_FLUSH_WORK_THRES,
+	RO_CFG_FLUSH_TOTAL_THRES,
+	RO_CFG_AUTO_FLUSH_TIME,
+	RO_CFG_MAN_FLUSH_TIME,
+	RO_CFG_EXTRA_TIME
+};
+
+// Config A/B record, layout version
+#define RO_CFG_VER		1
 
 // -------------------------------------------------------------------------------------------------
 // data
 
-static uint32_t EEMEM ee_ro_data_num_starts;
-static uint32_t EEMEM ee_ro_data_num_flushes;
-static uint32_t EEMEM ee_ro_data_filter_total_time;
-static uint32_t EEMEM ee_ro_data_filter_work_time;
-static uint32_t EEMEM ee_ro_data_filter_noflushwrk_time;
-static uint32_t EEMEM ee_ro_data_total_on_time;
-static uint32_t EEMEM ee_ro_data_total_run_time;
-
-static uint32_t ro_data_num_starts;
-static uint32_t ro_data_num_flushes;
-static uint32_t ro_data_filter_total_time;
-static uint32_t ro_data_filter_work_time;
-static uint32_t ro_data_filter_noflushwrk_time;
-static uint32_t ro_data_total_on_time;
-static uint32_t ro_data_total_run_time;
+struct ro_data {
+	uint32_t num_starts;
+	uint32_t num_flushes;
+	uint32_t filter_total_time;
+	uint32_t filter_work_time;
+	uint32_t filter_noflushwrk_time;
+	uint32_t total_on_time;
+	uint32_t total_run_time;
+};
+
+static struct ro_data ro_data;
+
+// Data ring log, RO_DATA_RING_N records, layout version
+#define RO_DATA_VER		1
+
+// nonzero if counters changed since the last save
+
+static uint8_t ro_data_dirty;
+
+// -------------------------------------------------------------------------------------------------
+// EEPROM layout
+
+// Only EEPROM object, so the layout is fixed from address 0. Settings and data of the older
+// firmware stay at their fixed addresses first, they are imported if the records are not found.
+struct ee_ro {
+	uint8_t cfg_off;
+	uint32_t cfg_nowater_thres;
+	uint32_t cfg_timeout_thres;
+	uint32_t cfg_flush_work_thres;
+	uint32_t cfg_flush_total_thres;
+	uint32_t cfg_auto_flush_time;
+	uint32_t cfg_man_flush_time;
+	uint32_t cfg_extra_time;
+	uint32_t data_num_starts;
+	uint32_t data_num_flushes;
+	uint32_t data_filter_total_time;
+	uint32_t data_filter_work_time;
+	uint32_t data_filter_noflushwrk_time;
+	uint32_t data_total_on_time;
+	uint32_t data_total_run_time;
+	uint8_t cfg_ring[2][EE_RING_SLOT_SIZE(sizeof(struct ro_cfg))];
+	uint8_t data_ring[RO_DATA_RING_N][EE_RING_SLOT_SIZE(sizeof(struct ro_data))];
+	uint8_t log[RO_LOG_BLOCKS][EE_LOG_BLK_SIZE];
+};
+
+static struct ee_ro EEMEM ee_ro;
+
+static struct ee_ring ro_cfg_ring = EE_RING(ee_ro.cfg_ring, sizeof(struct ro_cfg), 2, RO_CFG_VER);
+static struct ee_ring ro_data_ring = EE_RING(ee_ro.data_ring, sizeof(struct ro_data), RO_DATA_RING_N, RO_DATA_VER);
+static struct ee_log ro_ev_log = EE_LOG(ee_ro.log, RO_LOG_BLOCKS);
+
+// -------------------------------------------------------------------------------------------------
+// settings save
+
+static uint8_t ro_cfg_loading;
+
+static void ro_cfg_save(struct tmr_oneshot *tmr);
+#ifndef OS_TMR_SLACK
+static struct tmr_oneshot ro_cfg_save_tmr = TMR_ONESHOT(ro_cfg_save);
+#else // OS_TMR_SLACK
+static struct tmr_oneshot ro_cfg_save_tmr = TMR_ONESHOT_SLACK(ro_cfg_save, T_MS(480));
+#endif // OS_TMR_SLACK
+
+// Queues the config record write, retries later if queue is full.
+static void ro_cfg_save(struct tmr_oneshot *tmr)
+{
+	if(ro_cfg_loading)
+		return;
+	if(!ee_ring_save(&ro_cfg_ring, &ro_cfg))
+		tmr_oneshot_set(&ro_cfg_save_tmr, TMR_UNIT_TICK, T_MS(96));
+}
 
 // -------------------------------------------------------------------------------------------------
-// 48ms timer
+// 48ms timer / events
+
+static void ro_update();
+
+#ifndef RO_EVENT_DRIVEN
+static void ro_update_poll(struct tmr_interval *tmr)
+{
+	ro_update();
+}
+
+static struct tmr_interval ro_update_tmr = TMR_INTERVAL(ro_update_poll, T_MS(48));
+#else // RO_EVENT_DRIVEN
+static void ro_update_event(struct task_handle *task)
+{
+	ro_update();
+}
+
+#ifndef OS_TMR_RTC
+static void ro_update_deadline(struct tmr_oneshot *tmr)
+#else // OS_TMR_RTC
+static void ro_update_deadline(struct tmr_rtc *tmr)
+#endif // OS_TMR_RTC
+{
+	ro_update();
+}
+
+static void ro_alarm(struct tmr_interval *tmr);
+
+struct task_handle ro_update_task = TASK_HANDLE(ro_update_event);
+#ifndef OS_TMR_RTC
+static struct tmr_oneshot ro_deadline_tmr = TMR_ONESHOT(ro_update_deadline);
+#else // OS_TMR_RTC
+static struct tmr_rtc ro_deadline_tmr = TMR_RTC(ro_update_deadline);
+#endif // OS_TMR_RTC
+static struct tmr_interval ro_alarm_tmr = TMR_INTERVAL(ro_alarm, T_MS(672));
+static uint8_t ro_inlet_on;
+static uint8_t ro_refill_on;
+static uint8_t ro_alarm_on;
+static uint8_t ro_beep_cnt;
+#endif // RO_EVENT_DRIVEN
 
 static uint8_t ro_state;
 static uint32_t ro_flush_time;
@@ -75,10 +183,33 @@ static uint32_t ro_total_upd_mark;
 static uint32_t ro_data_save_mark;
 static uint32_t ro_work_sw_mark;
 
+// Logs the state transition. Event code: cause << 3 | state.
+static void ro_log(uint8_t cause)
+{
+	ee_log_put(&ro_ev_log, (cause << 3) | ro_state, t_rtc_sec);
+}
+
+void ro_log_first(struct ee_log_iter *it)
+{
+	ee_log_first(&ro_ev_log, it);
+}
+
+uint8_t ro_log_next(struct ee_log_iter *it, uint8_t *state, uint8_t *cause, uint32_t *t)
+{
+	uint8_t code;
+	if(!ee_log_next(&ro_ev_log, it, &code, t))
+		return 0;
+	*state = code & 0x07;
+	*cause = code >> 3;
+	return 1;
+}
+
 static void ro_update_total_time()
 {
-	ro_data_filter_total_time += t_rtc_sec - ro_total_upd_mark;
-	ro_data_total_on_time += t_rtc_sec - ro_total_upd_mark;
+	ro_data.filter_total_time += t_rtc_sec - ro_total_upd_mark;
+	ro_data.total_on_time += t_rtc_sec - ro_total_upd_mark;
+	if(t_rtc_sec != ro_total_upd_mark)
+		ro_data_dirty = 1;
 	ro_total_upd_mark = t_rtc_sec;
 }
 
@@ -86,10 +217,12 @@ static void ro_update_run_time()
 {
 	if((ro_state == RO_WORK) || (ro_state == RO_FLUSH)) {
 		uint32_t elap = t_rtc_sec - ro_start_mark;
-		ro_data_filter_work_time += elap;
-		ro_data_total_run_time += elap;
+		ro_data.filter_work_time += elap;
+		ro_data.total_run_time += elap;
 		if(ro_state == RO_WORK)
-			ro_data_filter_noflushwrk_time += elap;
+			ro_data.filter_noflushwrk_time += elap;
+		if(elap != 0)
+			ro_data_dirty = 1;
 		ro_start_mark = t_rtc_sec;
 	}
 }
@@ -99,8 +232,10 @@ static void ro_work()
 	ro_update_run_time();
 	WORK_ON();
 	BYPASS_OFF();
-	if((ro_state != RO_WORK) && (ro_state != RO_FLUSH))
-		ro_data_num_starts++;
+	if((ro_state != RO_WORK) && (ro_state != RO_FLUSH)) {
+		ro_data.num_starts++;
+		ro_data_dirty = 1;
+	}
 	ro_start_mark = t_rtc_sec;
 	ro_work_sw_mark = t_rtc_sec;
 	ro_state = RO_WORK;
@@ -112,10 +247,11 @@ static void ro_flush(uint32_t flush_time)
 	WORK_ON();
 	BYPASS_ON();
 	if((ro_state != RO_WORK) && (ro_state != RO_FLUSH))
-		ro_data_num_starts++;
+		ro_data.num_starts++;
 	if(ro_state != RO_FLUSH)
-		ro_data_num_flushes++;
-	ro_data_filter_noflushwrk_time = 0;
+		ro_data.num_flushes++;
+	ro_data.filter_noflushwrk_time = 0;
+	ro_data_dirty = 1;
 	ro_last_flush_mark = t_rtc_sec;
 	ro_start_mark = t_rtc_sec;
 	ro_flush_time = flush_time;
@@ -135,13 +271,108 @@ uint8_t ro_get_state()
 	return ro_state;
 }
 
-void ro_update(struct tmr_interval *tmr)
+#ifdef RO_EVENT_DRIVEN
+
+// Schedules the state machine update after a command or a config change.
+static void ro_sched_update()
+{
+	if(ro_state != RO_DISABLED)
+		task_schedule(&ro_update_task, TASK_PRIORITY_NORMAL);
+}
+
+// Alarm beep, every 672ms.
+static void ro_alarm(struct tmr_interval *tmr)
 {
+	beep(7);
+	// nowater alarm stops after 10 beeps, timeout alarm beeps until reset
+	if((ro_state == RO_NOWATER) && (++ro_beep_cnt == 10))
+		tmr_interval_cancel(tmr);
+}
+
+// Updates the nearest deadline d (seconds from t) with the deadline timestamp.
+static void ro_deadline_min(uint32_t *d, uint32_t t, uint32_t stamp)
+{
+	uint32_t elap = stamp - t;
+	if(elap & 0x80000000)
+		elap = 0;
+	if(elap < *d)
+		*d = elap;
+}
+
+// Sets the timer for the nearest state machine deadline.
+static void ro_deadline_set(uint32_t t)
+{
+	uint32_t d = 0xffffffff;
+	switch(ro_state) {
+	case RO_IDLE:
+		// Idle -> Flush (total time since last flush)
+		if( INLET_SW_ON() &&
+			(ro_cfg.flush_total_thres != 0) &&
+			(ro_cfg.auto_flush_time != 0) )
+		{
+			ro_deadline_min(&d, t, ro_last_flush_mark + ro_cfg.flush_total_thres);
+		}
+		break;
+	case RO_WORK:
+		// Work -> Timeout
+		if(ro_cfg.timeout_thres != 0)
+			ro_deadline_min(&d, t, ro_start_mark + ro_cfg.timeout_thres + 1);
+		// Work -> Idle/Flush
+		if(!REFILL_SW_ON())
+			ro_deadline_min(&d, t, ro_work_sw_mark + ro_cfg.extra_time);
+		break;
+	case RO_FLUSH:
+		// Flush -> Work/Idle
+		ro_deadline_min(&d, t, ro_start_mark + ro_flush_time);
+		break;
+	}
+	// Nowater check
+	if( !INLET_SW_ON() &&
+		((ro_state == RO_IDLE) || (ro_state == RO_WORK) || (ro_state == RO_FLUSH)) )
+	{
+		ro_deadline_min(&d, t, ro_nowater_mark + ro_cfg.nowater_thres);
+	}
+	// Save data
+	ro_deadline_min(&d, t, ro_data_save_mark + RO_DATA_SAVE_INTERVAL);
+#ifdef OS_TMR_RTC
+	// RTC timer triggers on the t_rtc_sec update passing the deadline
+	tmr_rtc_set_at(&ro_deadline_tmr, t + d);
+#else // OS_TMR_RTC
+	// t_rtc_sec is updated every 2s and timer may trigger up to 1s early,
+	// wait 2s more to pass the deadline. too early update sets the timer again.
+	d += 2;
+	if(d > TMR_ELAPSE_MAX)
+		d = TMR_ELAPSE_MAX;
+	tmr_oneshot_set(&ro_deadline_tmr, TMR_UNIT_SECOND, (uint16_t)d);
+#endif // OS_TMR_RTC
+}
+
+#else // !RO_EVENT_DRIVEN
+
+#define ro_sched_update()
+
+#endif // !RO_EVENT_DRIVEN
+
+static void ro_update()
+{
+#ifndef RO_EVENT_DRIVEN
 	static uint8_t beep_cnt;
 	static uint8_t beep_tmr;
+#endif // !RO_EVENT_DRIVEN
 
 	uint32_t t = t_rtc_sec;
 
+#ifdef RO_EVENT_DRIVEN
+	// Switches are sampled on change only, the switch on marks are kept
+	// until the switch off edge.
+	if(ro_inlet_on)
+		ro_nowater_mark = t;
+	if(ro_refill_on && (ro_state == RO_WORK))
+		ro_work_sw_mark = t;
+	ro_inlet_on = INLET_SW_ON();
+	ro_refill_on = REFILL_SW_ON();
+#endif // RO_EVENT_DRIVEN
+
 	switch(ro_state)
 	{
 	// -----------------------------------------------------
@@ -150,15 +381,17 @@ void ro_update(struct tmr_interval *tmr)
 		if(!INLET_SW_ON())
 			break;
 		// Idle -> Flush (total time since last flush)
-		if( (ro_cfg_flush_total_thres != 0) &&
-			(ro_cfg_auto_flush_time != 0) &&
-			(t - ro_last_flush_mark >= ro_cfg_flush_total_thres) )
+		if( (ro_cfg.flush_total_thres != 0) &&
+			(ro_cfg.auto_flush_time != 0) &&
+			(t - ro_last_flush_mark >= ro_cfg.flush_total_thres) )
 		{
-			ro_flush(ro_cfg_auto_flush_time);
+			ro_flush(ro_cfg.auto_flush_time);
+			ro_log(RO_EV_FLUSH_TOTAL);
 		}
 		// Idle -> Work
 		else if(REFILL_SW_ON()) {
 			ro_work();
+			ro_log(RO_EV_REFILL_ON);
 		}
 		break;
 
@@ -166,26 +399,29 @@ void ro_update(struct tmr_interval *tmr)
 	// Work (refill)
 	case RO_WORK:
 		// Work -> Timeout
-		if((ro_cfg_timeout_thres != 0) && (t - ro_start_mark > ro_cfg_timeout_thres)) {
+		if((ro_cfg.timeout_thres != 0) && (t - ro_start_mark > ro_cfg.timeout_thres)) {
 			ro_idle();
 			ro_state = RO_TIMEOUT;
+			ro_log(RO_EV_TIMEOUT);
 		}
 		// Work -> Idle/Flush
 		else if(REFILL_SW_ON()) {
 			ro_work_sw_mark = t;
-		} else if(t - ro_work_sw_mark >= ro_cfg_extra_time) {
+		} else if(t - ro_work_sw_mark >= ro_cfg.extra_time) {
 			ro_update_run_time();
 			// Work -> Flush
-			if( (ro_cfg_flush_work_thres != 0) &&
-				(ro_cfg_auto_flush_time != 0) &&
-				(ro_data_filter_noflushwrk_time >= ro_cfg_flush_work_thres) &&
+			if( (ro_cfg.flush_work_thres != 0) &&
+				(ro_cfg.auto_flush_time != 0) &&
+				(ro_data.filter_noflushwrk_time >= ro_cfg.flush_work_thres) &&
 				INLET_SW_ON() )
 			{
-				ro_flush(ro_cfg_auto_flush_time);
+				ro_flush(ro_cfg.auto_flush_time);
+				ro_log(RO_EV_FLUSH_WORK);
 			}
 			// Work -> Idle
 			else {
 				ro_idle();
+				ro_log(RO_EV_REFILL_OFF);
 				beep(5);
 			}
 		}
@@ -203,6 +439,7 @@ void ro_update(struct tmr_interval *tmr)
 			ro_idle();
 			beep(5);
 		}
+		ro_log(RO_EV_FLUSH_END);
 		break;
 
 	// -----------------------------------------------------
@@ -212,11 +449,12 @@ void ro_update(struct tmr_interval *tmr)
 			break;
 		beep(5);
 		// Nowater -> Flush/Idle
-		if(ro_cfg_auto_flush_time != 0) {
-			ro_flush(ro_cfg_auto_flush_time);
+		if(ro_cfg.auto_flush_time != 0) {
+			ro_flush(ro_cfg.auto_flush_time);
 		} else {
 			ro_idle();
 		}
+		ro_log(RO_EV_WATER_ON);
 		break;
 	}
 
@@ -225,14 +463,16 @@ void ro_update(struct tmr_interval *tmr)
 	if(INLET_SW_ON()) {
 		ro_nowater_mark = t;
 	} else if( ((ro_state == RO_IDLE) || (ro_state == RO_WORK) || (ro_state == RO_FLUSH)) &&
-	           (t - ro_nowater_mark >= ro_cfg_nowater_thres) )
+	           (t - ro_nowater_mark >= ro_cfg.nowater_thres) )
 	{
 		ro_idle();
 		ro_state = RO_NOWATER;
+		ro_log(RO_EV_WATER_OFF);
 	}
 
 	// -----------------------------------------------------
 	// Alarm
+#ifndef RO_EVENT_DRIVEN
 	if((ro_state == RO_NOWATER) || (ro_state == RO_TIMEOUT)) {
 		if((ro_state == RO_TIMEOUT) || (beep_cnt < 10)) {
 			if(++beep_tmr == 14) {
@@ -245,6 +485,18 @@ void ro_update(struct tmr_interval *tmr)
 		beep_tmr = 0;
 		beep_cnt = 0;
 	}
+#else // RO_EVENT_DRIVEN
+	if((ro_state == RO_NOWATER) || (ro_state == RO_TIMEOUT)) {
+		if(!ro_alarm_on) {
+			ro_alarm_on = 1;
+			ro_beep_cnt = 0;
+			tmr_interval_set(&ro_alarm_tmr, TMR_UNIT_TICK, T_MS(672));
+		}
+	} else if(ro_alarm_on) {
+		ro_alarm_on = 0;
+		tmr_interval_cancel(&ro_alarm_tmr);
+	}
+#endif // RO_EVENT_DRIVEN
 
 	// -----------------------------------------------------
 	// Update data
@@ -253,8 +505,14 @@ void ro_update(struct tmr_interval *tmr)
 
 	// -----------------------------------------------------
 	// Save data
-	if(t - ro_data_save_mark >= 86400)
+	if(t - ro_data_save_mark >= RO_DATA_SAVE_INTERVAL)
 		ro_save_ee();
+
+#ifdef RO_EVENT_DRIVEN
+	// -----------------------------------------------------
+	// Next deadline
+	ro_deadline_set(t);
+#endif // RO_EVENT_DRIVEN
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -265,23 +523,28 @@ void ro_reset()
 	if((ro_state != RO_FLUSH) && (ro_state != RO_TIMEOUT))
 		return;
 	ro_idle();
+	ro_log(RO_EV_USER);
+	ro_sched_update();
 }
 
 void ro_start_flush()
 {
 	if((ro_state != RO_IDLE) && (ro_state != RO_WORK) && (ro_state != RO_FLUSH))
 		return;
-	if((ro_cfg_man_flush_time == 0) || !INLET_SW_ON())
+	if((ro_cfg.man_flush_time == 0) || !INLET_SW_ON())
 		return;
-	ro_flush(ro_cfg_man_flush_time);
+	ro_flush(ro_cfg.man_flush_time);
+	ro_log(RO_EV_USER);
+	ro_sched_update();
 }
 
 void ro_filter_reset()
 {
 	ro_update_total_time();
-	ro_data_filter_total_time = 0;
-	ro_data_filter_work_time = 0;
-	ro_data_filter_noflushwrk_time = 0;
+	ro_data.filter_total_time = 0;
+	ro_data.filter_work_time = 0;
+	ro_data.filter_noflushwrk_time = 0;
+	ro_data_dirty = 1;
 }
 
 void ro_set_lamp(uint8_t on)
@@ -298,20 +561,24 @@ void ro_set_lamp(uint8_t on)
 void ro_set_off(uint8_t off)
 {
 	if(off) {
-		if(ro_cfg_off)
+		if(ro_cfg.off)
 			return;
-		ro_cfg_off = 1;
-		eeprom_write_byte(&ee_ro_cfg_off, 1);
+		ro_cfg.off = 1;
+		ro_cfg_save(NULL);
 		ro_idle();
 		ro_state = RO_OFF;
+		ro_log(RO_EV_USER);
 	} else {
-		if(!ro_cfg_off)
+		if(!ro_cfg.off)
 			return;
-		ro_cfg_off = 0;
-		eeprom_write_byte(&ee_ro_cfg_off, 0);
-		if(ro_state == RO_OFF)
+		ro_cfg.off = 0;
+		ro_cfg_save(NULL);
+		if(ro_state == RO_OFF) {
 			ro_state = RO_IDLE;
+			ro_log(RO_EV_USER);
+		}
 	}
+	ro_sched_update();
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -321,105 +588,112 @@ void ro_set_nowater_thres(uint32_t thres)
 {
 	if(thres > 60)
 		thres = RO_CFG_NOWATER_THRES;
-	if(thres != ro_cfg_nowater_thres) {
-		ro_cfg_nowater_thres = thres;
-		eeprom_write_dword(&ee_ro_cfg_nowater_thres, thres);
+	if(thres != ro_cfg.nowater_thres) {
+		ro_cfg.nowater_thres = thres;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_nowater_thres()
 {
-	return ro_cfg_nowater_thres;
+	return ro_cfg.nowater_thres;
 }
 
 void ro_set_timeout_thres(uint32_t thres)
 {
 	if(thres > 21600)
 		thres = RO_CFG_TIMEOUT_THRES;
-	if(thres != ro_cfg_timeout_thres) {
-		ro_cfg_timeout_thres = thres;
-		eeprom_write_dword(&ee_ro_cfg_timeout_thres, thres);
+	if(thres != ro_cfg.timeout_thres) {
+		ro_cfg.timeout_thres = thres;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_timeout_thres()
 {
-	return ro_cfg_timeout_thres;
+	return ro_cfg.timeout_thres;
 }
 
 void ro_set_flush_work_thres(uint32_t thres)
 {
 	if(thres > 59400)
 		thres = RO_CFG_FLUSH_WORK_THRES;
-	if(thres != ro_cfg_flush_work_thres) {
-		ro_cfg_flush_work_thres = thres;
-		eeprom_write_dword(&ee_ro_cfg_flush_work_thres, thres);
+	if(thres != ro_cfg.flush_work_thres) {
+		ro_cfg.flush_work_thres = thres;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_flush_work_thres()
 {
-	return ro_cfg_flush_work_thres;
+	return ro_cfg.flush_work_thres;
 }
 
 void ro_set_flush_total_thres(uint32_t thres)
 {
 	if(thres > 864000)
 		thres = RO_CFG_FLUSH_TOTAL_THRES;
-	if(thres != ro_cfg_flush_total_thres) {
-		ro_cfg_flush_total_thres = thres;
-		eeprom_write_dword(&ee_ro_cfg_flush_total_thres, thres);
+	if(thres != ro_cfg.flush_total_thres) {
+		ro_cfg.flush_total_thres = thres;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_flush_total_thres()
 {
-	return ro_cfg_flush_total_thres;
+	return ro_cfg.flush_total_thres;
 }
 
 void ro_set_auto_flush_time(uint32_t val)
 {
 	if(val > 900)
 		val = RO_CFG_AUTO_FLUSH_TIME;
-	if(val != ro_cfg_auto_flush_time) {
-		ro_cfg_auto_flush_time = val;
-		eeprom_write_dword(&ee_ro_cfg_auto_flush_time, val);
+	if(val != ro_cfg.auto_flush_time) {
+		ro_cfg.auto_flush_time = val;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_auto_flush_time()
 {
-	return ro_cfg_auto_flush_time;
+	return ro_cfg.auto_flush_time;
 }
 
 void ro_set_man_flush_time(uint32_t val)
 {
 	if(val > 3600)
 		val = RO_CFG_MAN_FLUSH_TIME;
-	if(val != ro_cfg_man_flush_time) {
-		ro_cfg_man_flush_time = val;
-		eeprom_write_dword(&ee_ro_cfg_man_flush_time, val);
+	if(val != ro_cfg.man_flush_time) {
+		ro_cfg.man_flush_time = val;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_man_flush_time()
 {
-	return ro_cfg_man_flush_time;
+	return ro_cfg.man_flush_time;
 }
 
 void ro_set_extra_time(uint32_t val)
 {
 	if(val > 360)
 		val = RO_CFG_EXTRA_TIME;
-	if(val != ro_cfg_extra_time) {
-		ro_cfg_extra_time = val;
-		eeprom_write_dword(&ee_ro_cfg_extra_time, val);
+	if(val != ro_cfg.extra_time) {
+		ro_cfg.extra_time = val;
+		ro_cfg_save(NULL);
+		ro_sched_update();
 	}
 }
 
 uint32_t ro_get_extra_time()
 {
-	return ro_cfg_extra_time;
+	return ro_cfg.extra_time;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -427,23 +701,23 @@ uint32_t ro_get_extra_time()
 
 uint32_t ro_get_num_starts()
 {
-	return ro_data_num_starts;
+	return ro_data.num_starts;
 }
 
 uint32_t ro_get_num_flushes()
 {
-	return ro_data_num_flushes;
+	return ro_data.num_flushes;
 }
 
 uint32_t ro_get_filter_total_time()
 {
-	return ro_data_filter_total_time +
+	return ro_data.filter_total_time +
 		(t_rtc_sec - ro_total_upd_mark);
 }
 
 uint32_t ro_get_filter_work_time()
 {
-	uint32_t val = ro_data_filter_work_time;
+	uint32_t val = ro_data.filter_work_time;
 	if((ro_state == RO_WORK) || (ro_state == RO_FLUSH))
 		val += t_rtc_sec - ro_start_mark;
 	return val;
@@ -458,13 +732,13 @@ uint32_t ro_get_current_work_time()
 
 uint32_t ro_get_total_on_time()
 {
-	return ro_data_total_on_time +
+	return ro_data.total_on_time +
 		(t_rtc_sec - ro_total_upd_mark);
 }
 
 uint32_t ro_get_total_run_time()
 {
-	uint32_t val = ro_data_total_run_time;
+	uint32_t val = ro_data.total_run_time;
 	if((ro_state == RO_WORK) || (ro_state == RO_FLUSH))
 		val += t_rtc_sec - ro_start_mark;
 	return val;
@@ -474,56 +748,95 @@ uint32_t ro_get_total_run_time()
 
 void ro_load_ee()
 {
-	ro_cfg_off = eeprom_read_byte(&ee_ro_cfg_off);
-	if(ro_cfg_off > 1)	ro_cfg_off = 0;
-
-	ro_set_nowater_thres(eeprom_read_dword(&ee_ro_cfg_nowater_thres));
-	ro_set_timeout_thres(eeprom_read_dword(&ee_ro_cfg_timeout_thres));
-	ro_set_flush_work_thres(eeprom_read_dword(&ee_ro_cfg_flush_work_thres));
-	ro_set_flush_total_thres(eeprom_read_dword(&ee_ro_cfg_flush_total_thres));
-	ro_set_auto_flush_time(eeprom_read_dword(&ee_ro_cfg_auto_flush_time));
-	ro_set_man_flush_time(eeprom_read_dword(&ee_ro_cfg_man_flush_time));
-	ro_set_extra_time(eeprom_read_dword(&ee_ro_cfg_extra_time));
-
-	ro_data_num_starts = eeprom_read_dword(&ee_ro_data_num_starts);
-	ro_data_num_flushes = eeprom_read_dword(&ee_ro_data_num_flushes);
-	ro_data_filter_total_time = eeprom_read_dword(&ee_ro_data_filter_total_time);
-	ro_data_filter_work_time = eeprom_read_dword(&ee_ro_data_filter_work_time);
-	ro_data_filter_noflushwrk_time = eeprom_read_dword(&ee_ro_data_filter_noflushwrk_time);
-	ro_data_total_on_time = eeprom_read_dword(&ee_ro_data_total_on_time);
-	ro_data_total_run_time = eeprom_read_dword(&ee_ro_data_total_run_time);
-
-	if(ro_data_num_starts == 0xffffffff)				ro_data_num_starts = 0;
-	if(ro_data_num_flushes == 0xffffffff)				ro_data_num_flushes = 0;
-	if(ro_data_filter_total_time == 0xffffffff)			ro_data_filter_total_time = 0;
-	if(ro_data_filter_work_time == 0xffffffff)			ro_data_filter_work_time = 0;
-	if(ro_data_filter_noflushwrk_time == 0xffffffff)	ro_data_filter_noflushwrk_time = 0;
-	if(ro_data_total_on_time == 0xffffffff)				ro_data_total_on_time = 0;
-	if(ro_data_total_run_time == 0xffffffff)			ro_data_total_run_time = 0;
+	struct ro_cfg cfg;
+	uint8_t force_save = 0;
+
+	// config record, older firmware settings if not found
+	if(!ee_ring_load(&ro_cfg_ring, &cfg)) {
+		cfg.off = ee_read_byte(&ee_ro.cfg_off);
+		cfg.nowater_thres = ee_read_dword(&ee_ro.cfg_nowater_thres);
+		cfg.timeout_thres = ee_read_dword(&ee_ro.cfg_timeout_thres);
+		cfg.flush_work_thres = ee_read_dword(&ee_ro.cfg_flush_work_thres);
+		cfg.flush_total_thres = ee_read_dword(&ee_ro.cfg_flush_total_thres);
+		cfg.auto_flush_time = ee_read_dword(&ee_ro.cfg_auto_flush_time);
+		cfg.man_flush_time = ee_read_dword(&ee_ro.cfg_man_flush_time);
+		cfg.extra_time = ee_read_dword(&ee_ro.cfg_extra_time);
+		force_save = 1;
+	}
+
+	// range check by the setters, save record once if anything was corrected
+	ro_cfg_loading = 1;
+	ro_cfg.off = (cfg.off == 1);
+	ro_set_nowater_thres(cfg.nowater_thres);
+	ro_set_timeout_thres(cfg.timeout_thres);
+	ro_set_flush_work_thres(cfg.flush_work_thres);
+	ro_set_flush_total_thres(cfg.flush_total_thres);
+	ro_set_auto_flush_time(cfg.auto_flush_time);
+	ro_set_man_flush_time(cfg.man_flush_time);
+	ro_set_extra_time(cfg.extra_time);
+	ro_cfg_loading = 0;
+	if(force_save || (memcmp(&cfg, &ro_cfg, sizeof(struct ro_cfg)) != 0))
+		ro_cfg_save(NULL);
+
+	// event log write position
+	ee_log_load(&ro_ev_log, t_rtc_sec);
+
+	// data record, older firmware counters if not found
+	ro_data_dirty = 0;
+	if(!ee_ring_load(&ro_data_ring, &ro_data)) {
+		ro_data.num_starts = ee_read_dword(&ee_ro.data_num_starts);
+		ro_data.num_flushes = ee_read_dword(&ee_ro.data_num_flushes);
+		ro_data.filter_total_time = ee_read_dword(&ee_ro.data_filter_total_time);
+		ro_data.filter_work_time = ee_read_dword(&ee_ro.data_filter_work_time);
+		ro_data.filter_noflushwrk_time = ee_read_dword(&ee_ro.data_filter_noflushwrk_time);
+		ro_data.total_on_time = ee_read_dword(&ee_ro.data_total_on_time);
+		ro_data.total_run_time = ee_read_dword(&ee_ro.data_total_run_time);
+
+		if(ro_data.num_starts == 0xffffffff)				ro_data.num_starts = 0;
+		if(ro_data.num_flushes == 0xffffffff)				ro_data.num_flushes = 0;
+		if(ro_data.filter_total_time == 0xffffffff)			ro_data.filter_total_time = 0;
+		if(ro_data.filter_work_time == 0xffffffff)			ro_data.filter_work_time = 0;
+		if(ro_data.filter_noflushwrk_time == 0xffffffff)	ro_data.filter_noflushwrk_time = 0;
+		if(ro_data.total_on_time == 0xffffffff)				ro_data.total_on_time = 0;
+		if(ro_data.total_run_time == 0xffffffff)			ro_data.total_run_time = 0;
+		ro_data_dirty = 1;
+	}
 }
 
 void ro_save_ee()
 {
-	eeprom_update_dword(&ee_ro_data_num_starts, ro_data_num_starts);
-	eeprom_update_dword(&ee_ro_data_num_flushes, ro_data_num_flushes);
-	eeprom_update_dword(&ee_ro_data_filter_total_time, ro_data_filter_total_time);
-	eeprom_update_dword(&ee_ro_data_filter_work_time, ro_data_filter_work_time);
-	eeprom_update_dword(&ee_ro_data_filter_noflushwrk_time, ro_data_filter_noflushwrk_time);
-	eeprom_update_dword(&ee_ro_data_total_on_time, ro_data_total_on_time);
-	eeprom_update_dword(&ee_ro_data_total_run_time, ro_data_total_run_time);
-	ro_data_save_mark = t_rtc_sec;
+	clk_fast_begin();
+	ro_update_total_time();
+	// new record to the data ring. periodic save is retried on the next update if queue is full,
+	// power fail save has the queue space reserved.
+	if(!ro_data_dirty || ee_ring_save(&ro_data_ring, &ro_data)) {
+		ro_data_dirty = 0;
+		ro_data_save_mark = t_rtc_sec;
+	}
+	clk_fast_end();
 }
 
 // -------------------------------------------------------------------------------------------------
 
-static struct tmr_interval ro_update_tmr = TMR_INTERVAL(ro_update, T_MS(48));
-
 void ro_enable()
 {
 	if(ro_state != RO_DISABLED)
 		return;
+#ifndef RO_EVENT_DRIVEN
 	tmr_interval_set(&ro_update_tmr, TMR_UNIT_TICK, 0);
-	ro_state = ro_cfg_off ? RO_OFF : RO_IDLE;
+#else // RO_EVENT_DRIVEN
+	ro_inlet_on = 0;
+	ro_refill_on = 0;
+	task_flag_bind(DI_CHANGE_FLAG_ID, &ro_update_task, TASK_PRIORITY_NORMAL);
+	DI_INT_ENABLE();
+	task_schedule(&ro_update_task, TASK_PRIORITY_NORMAL);
+#endif // RO_EVENT_DRIVEN
+	ro_state = ro_cfg.off ? RO_OFF : RO_IDLE;
+	ro_log(RO_EV_PWR);
+#ifdef RO_PWRFAIL_SAVE
+	// queue space for the power fail save
+	ee_reserve(EE_RING_SLOT_SIZE(sizeof(struct ro_data)), 2);
+#endif // RO_PWRFAIL_SAVE
 }
 
 void ro_disable()
@@ -532,8 +845,30 @@ void ro_disable()
 		return;
 	ro_idle();
 	LAMP_OFF();
+#ifdef RO_PWRFAIL_SAVE
+	// record goes to the reserved space, written first
+	ee_reserve(0, 0);
+	ee_priority(1);
+	ro_save_ee();
+	ee_priority(0);
+#endif // RO_PWRFAIL_SAVE
+#ifndef RO_EVENT_DRIVEN
 	tmr_interval_cancel(&ro_update_tmr);
+#else // RO_EVENT_DRIVEN
+	DI_INT_DISABLE();
+	task_flag_unbind(DI_CHANGE_FLAG_ID);
+	task_cancel(&ro_update_task);
+#ifndef OS_TMR_RTC
+	tmr_oneshot_cancel(&ro_deadline_tmr);
+#else // OS_TMR_RTC
+	tmr_rtc_cancel(&ro_deadline_tmr);
+#endif // OS_TMR_RTC
+	tmr_interval_cancel(&ro_alarm_tmr);
+	ro_alarm_on = 0;
+#endif // RO_EVENT_DRIVEN
 	ro_state = RO_DISABLED;
+	// after the power fail save, logged if queue has space
+	ro_log(RO_EV_PWR);
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -16,6 +16,20 @@ enum {
 	RO_TIMEOUT
 };
 
+// event log causes
+enum {
+	RO_EV_PWR,				// power on/off
+	RO_EV_USER,				// menu command
+	RO_EV_REFILL_ON,		// refill switch on
+	RO_EV_REFILL_OFF,		// refill switch off for the extra time
+	RO_EV_FLUSH_TOTAL,		// auto flush by the total time
+	RO_EV_FLUSH_WORK,		// auto flush by the work time
+	RO_EV_FLUSH_END,		// flush time passed
+	RO_EV_TIMEOUT,			// work timeout
+	RO_EV_WATER_OFF,		// inlet switch off for the nowater time
+	RO_EV_WATER_ON,			// inlet switch on
+};
+
 uint8_t ro_get_state();
 
 // commands
@@ -55,4 +69,10 @@ uint32_t ro_get_total_run_time();
 void ro_load_ee();
 void ro_save_ee();
 
+// event log, from the oldest to the newest transition.
+// t is t_rtc_sec continued over the power cycles.
+struct ee_log_iter;
+void ro_log_first(struct ee_log_iter *it);
+uint8_t ro_log_next(struct ee_log_iter *it, uint8_t *state, uint8_t *cause, uint32_t *t);
+
 // -------------------------------------------------------------------------------------------------